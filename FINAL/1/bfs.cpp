@@ -1,105 +1,160 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <queue>
 #include <climits>
 #include <algorithm>
 #include <string>
 #include <chrono>
 #include <windows.h>
 #include <psapi.h>
+#include "../common/grid_io.h"
+#include "../common/bitset_bfs.h"
+#include "../common/jps.h"
+#include "../common/search.h"
 
 using namespace std;
 
 #define GRID_FILE "grid.txt"
-
-struct Coordinate { int x, y; };
-struct Node { int id; };
-
+// BIDIRECTIONAL_BFS = true: bfs() mencari dari start dan goal sekaligus (bfsBidirectional).
+const bool BIDIRECTIONAL_BFS = false;
+// BITSET_BFS = true: bfs() memakai BFS bit-parallel per level (BitsetBfs).
+const bool BITSET_BFS = false;
+// JUMP_POINT_SEARCH = true: bfs() memakai Jump Point Search 4-arah (JumpPointSearch);
+// JPS_PLUS = true menambahkan tabel jarak lompatan yang dihitung sekali di awal.
+const bool JUMP_POINT_SEARCH = false;
+const bool JPS_PLUS = false;
+
+BitsetBfs bitbfs;
+JumpPointSearch jps;
 long long tiles_opened = 0;
 long long total_weight = 0;
 
-bool readGrid(const string &filename, int &X, int &Y, vector<vector<int>> &grid, int &start_id, int &goal_id)
+bool readGrid(const string &filename, Grid &grid, int &start_id, int &goal_id)
 {
-    ifstream gridFile(filename);
-    if (!gridFile.is_open()) return false;
-    gridFile >> X >> Y;
-    grid.assign(Y, vector<int>(X));
-    start_id = -1;
-    goal_id = -1;
-    auto id = [X](int x, int y) { return y * X + x; };
-
-    for (int y = 0; y < Y; ++y)
+    vector<Coordinate> pokemons;
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(filename, grid, start_id, goal_id, pokemons, tunnels, error))
     {
-        for (int x = 0; x < X; ++x)
-        {
-            string t;
-            gridFile >> t;
-            if (t == "S") { grid[y][x] = 1; start_id = id(x, y); }
-            else if (t == "G") { grid[y][x] = 1; goal_id = id(x, y); }
-            else grid[y][x] = atoi(t.c_str());
-        }
+        cerr << error << "\n";
+        return false;
     }
-    gridFile.close();
+    if (BITSET_BFS)
+        bitbfs.build(grid);
+    if (JUMP_POINT_SEARCH)
+        jps.build(grid, nullptr, JPS_PLUS);
     return true;
 }
 
-vector<Coordinate> bfs(const vector<vector<int>> &grid, int X, int Y, int start_id, int goal_id)
+// Coordinates of a path given as cell ids from start to goal; adds the
+// weight of every cell on it, start included, to total_weight.
+vector<Coordinate> walkPath(const Grid &grid, const vector<int> &ids)
 {
-    int V = X * Y;
-    vector<int> from(V, -1);
-    vector<char> visited(V, 0);
-    auto id = [X](int x, int y) { return y * X + x; };
-    auto neighbors = [&](int node)
+    vector<Coordinate> path;
+    for (int cur : ids)
     {
-        int x = node % X, y = node / X;
-        vector<int> n;
-        if (y > 0) n.push_back(id(x, y - 1));
-        if (x > 0) n.push_back(id(x - 1, y));
-        if (y + 1 < Y) n.push_back(id(x, y + 1));
-        if (x + 1 < X) n.push_back(id(x + 1, y));
-        return n;
-    };
+        int w = 0;
+        if (grid[cur] == 1)
+            w = 2;
+        else if (grid[cur] == 2)
+            w = 1;
+        else if (grid[cur] == 3)
+            w = 3;
+        else if (grid[cur] == 4)
+            w = 5;
+        total_weight += w;
+        path.push_back(grid.coord(cur));
+    }
+    return path;
+}
 
-    queue<Node> q;
-    q.push({start_id});
-    visited[start_id] = 1;
+// Meet-in-the-middle BFS. Grows one whole level at a time from start_id or
+// from goal_id, whichever frontier is smaller. Moves between passable cells
+// go both ways, so the goal side walks the same
+// edges backwards. Each cell belongs to the side that reached it first:
+// depth[v] is d + 1 for the start side and -(d + 1) for the goal side. The
+// first level that touches the other side is finished to find the shortest
+// joint, and the search stops there.
+vector<Coordinate> bfsBidirectional(const Grid &grid, int start_id, int goal_id)
+{
+    int V = grid.size();
+    vector<int> from(V, -1);
+    vector<int> depth(V, 0);
+    vector<int> frontier[2] = {{start_id}, {goal_id}};
+    depth[start_id] = 1;
     tiles_opened++;
-
-    while (!q.empty())
+    int best = INT_MAX, meet_s = -1, meet_g = -1;
+    if (start_id == goal_id)
     {
-        Node cur = q.front();
-        q.pop();
-        if (cur.id == goal_id) break;
-        for (int v : neighbors(cur.id))
+        best = 0;
+        meet_s = start_id;
+    }
+    else
+    {
+        depth[goal_id] = -1;
+        tiles_opened++;
+    }
+    while (best == INT_MAX && !frontier[0].empty() && !frontier[1].empty())
+    {
+        int side = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+        int sign = side == 0 ? 1 : -1;
+        vector<int> next;
+        for (int u : frontier[side])
         {
-            int vx = v % X, vy = v / X;
-            if (grid[vy][vx] == 5) continue; // obstacle
-            if (visited[v]) continue;
-            visited[v] = 1;
-            tiles_opened++;
-            from[v] = cur.id;
-            q.push({v});
+            int du = depth[u] * sign;
+            forEachNeighbor(grid, u, [&](int v)
+            {
+                int dv = depth[v] * sign;
+                if (dv < 0)
+                {
+                    if (du - dv - 1 < best)
+                    {
+                        best = du - dv - 1;
+                        meet_s = side == 0 ? u : v;
+                        meet_g = side == 0 ? v : u;
+                    }
+                    return;
+                }
+                if (dv > 0)
+                    return;
+                depth[v] = (du + 1) * sign;
+                from[v] = u;
+                tiles_opened++;
+                next.push_back(v);
+            });
         }
+        frontier[side].swap(next);
     }
+    vector<int> ids;
+    if (best != INT_MAX)
+    {
+        for (int cur = meet_s; cur != -1; cur = from[cur])
+            ids.push_back(cur);
+        reverse(ids.begin(), ids.end());
+        for (int cur = meet_g; cur != -1; cur = from[cur])
+            ids.push_back(cur);
+    }
+    return walkPath(grid, ids);
+}
 
-    vector<Coordinate> path;
-    if (from[goal_id] != -1 || start_id == goal_id)
+vector<Coordinate> bfs(const Grid &grid, int start_id, int goal_id)
+{
+    if (BIDIRECTIONAL_BFS)
+        return bfsBidirectional(grid, start_id, goal_id);
+    if (BITSET_BFS)
     {
-        for (int cur = goal_id; cur != -1; cur = from[cur])
-        {
-            int x = cur % X, y = cur / X;
-            int w = 0;
-            if (grid[y][x] == 1) w = 2;
-            else if (grid[y][x] == 2) w = 1;
-            else if (grid[y][x] == 3) w = 3;
-            else if (grid[y][x] == 4) w = 5;
-            total_weight += w;
-            path.push_back({x, y});
-        }
-        reverse(path.begin(), path.end());
+        vector<int> ids = bitbfs.path(start_id, goal_id);
+        tiles_opened += bitbfs.reached();
+        return walkPath(grid, ids);
     }
-    return path;
+    if (JUMP_POINT_SEARCH)
+    {
+        vector<int> ids = jps.path(start_id, goal_id);
+        tiles_opened += jps.opened();
+        return walkPath(grid, ids);
+    }
+    SearchResult found = bestFirstSearch<FifoOpenList>(grid, start_id, goal_id, GridEdges{grid}, UnitCost());
+    tiles_opened += found.labelled;
+    return walkPath(grid, found.path);
 }
 
 void printMemoryUsage() {
@@ -109,14 +164,13 @@ void printMemoryUsage() {
     cout << "Memory usage: " << memUsed / (1024.0 * 1024.0) << " MB\n";
 }
 
-int main() {
+int main(int argc, char **argv) {
     auto start = chrono::high_resolution_clock::now();
 
-    int X, Y;
-    vector<vector<int>> grid;
+    Grid grid;
     int start_id, goal_id;
 
-    if (!readGrid(GRID_FILE, X, Y, grid, start_id, goal_id))
+    if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, grid, start_id, goal_id))
         return 1;
 
     if (start_id == -1 || goal_id == -1)
@@ -125,7 +179,7 @@ int main() {
         return 1;
     }
 
-    auto path = bfs(grid, X, Y, start_id, goal_id);
+    auto path = bfs(grid, start_id, goal_id);
 
     cout << "Shortest path (BFS):\n";
     for (auto &c : path)
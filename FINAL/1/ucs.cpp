@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <queue>
 #include <climits>
@@ -9,15 +8,24 @@
 #include <chrono>
 #include <windows.h>
 #include <psapi.h>
+#include "../common/grid_io.h"
+#include "../common/ch.h"
+#include "../common/search.h"
 
 using namespace std;
 
 #define GRID_FILE "grid.txt"
-
-struct Coordinate { int x, y; };
-struct Node { int id; float cost; bool operator>(const Node &o) const { return cost > o.cost; } };
+// BUCKET_QUEUE = true: ucs() memakai algoritma Dial, antrian bucket sebanyak bobot
+// terbesar + 1 (BucketOpenList), bukan binary heap; urutan node dibuka tetap sama.
+const bool BUCKET_QUEUE = false;
+// BIDIRECTIONAL_UCS = true: ucs() mencari dari start dan goal sekaligus (ucsBidirectional).
+const bool BIDIRECTIONAL_UCS = false;
+// CONTRACTION_HIERARCHY = true: ucs() menjawab lewat contraction hierarchy peta, dibangun
+// sekali lalu disimpan di <grid>.ch (ucsContracted). Didahulukan dari dua mode di atas.
+const bool CONTRACTION_HIERARCHY = false;
 
 int nodes_opened = 0;
+ContractionHierarchy ch;
 
 int getWeight(int t) {
     if (t == 1) return 2;
@@ -27,62 +35,108 @@ int getWeight(int t) {
     return INT_MAX;
 }
 
-bool readGrid(const string &f, int &X, int &Y, vector<vector<int>> &g, int &s, int &e) {
-    ifstream in(f);
-    if (!in.is_open()) return false;
-    in >> X >> Y;
-    g.assign(Y, vector<int>(X));
-    auto id = [X](int x, int y) { return y * X + x; };
-    for (int y = 0; y < Y; ++y)
-        for (int x = 0; x < X; ++x) {
-            string t; in >> t;
-            if (t == "S") { g[y][x] = 1; s = id(x, y); }
-            else if (t == "G") { g[y][x] = 1; e = id(x, y); }
-            else g[y][x] = atoi(t.c_str());
-        }
+// Loads the hierarchy cached next to the map file, or builds it and writes
+// the cache for the next run.
+void prepareHierarchy(const string &f, const Grid &g) {
+    string err;
+    if (ch.load(f + ".ch", g, nullptr, getWeight, err)) return;
+    ch.build(g, nullptr, getWeight);
+    if (!ch.save(f + ".ch", err)) cerr << err << "\n";
+}
+
+bool readGrid(const string &f, Grid &g, int &s, int &e) {
+    vector<Coordinate> p;
+    vector<Tunnel> tunnels;
+    string err;
+    if (!loadGrid(f, g, s, e, p, tunnels, err)) { cerr << err << "\n"; return false; }
+    if (CONTRACTION_HIERARCHY) prepareHierarchy(f, g);
     return true;
 }
 
-vector<Coordinate> ucs(const vector<vector<int>> &g, int X, int Y, int s, int e, float &tc) {
-    int V = X * Y;
-    vector<int> from(V, -1);
-    vector<float> cost(V, INFINITY);
-    vector<char> vis(V, 0);
-    auto id = [X](int x, int y) { return y * X + x; };
-    auto nbs = [&](int n) {
-        int x = n % X, y = n / X; vector<int> r;
-        if (y > 0) r.push_back(id(x, y - 1));
-        if (x > 0) r.push_back(id(x - 1, y));
-        if (y + 1 < Y) r.push_back(id(x, y + 1));
-        if (x + 1 < X) r.push_back(id(x + 1, y));
-        return r;
-    };
-    priority_queue<Node, vector<Node>, greater<Node>> pq;
-    pq.push({s, 0}); cost[s] = 0;
-    while (!pq.empty()) {
-        Node cur = pq.top(); pq.pop();
-        if (vis[cur.id]) continue;
-        vis[cur.id] = 1; nodes_opened++;
-        if (cur.id == e) break;
-        for (int v : nbs(cur.id)) {
-            int vx = v % X, vy = v / X;
-            if (g[vy][vx] == 5) continue;
-            float w = getWeight(g[vy][vx]);
-            if (w == INT_MAX) continue;
-            float nc = cost[cur.id] + w;
-            if (nc < cost[v]) { cost[v] = nc; from[v] = cur.id; pq.push({v, nc}); }
-        }
+// Dijkstra on the shared search loop; OpenList is the heap or Dial's buckets.
+template <typename OpenList>
+vector<Coordinate> ucsWith(const Grid &g, int s, int e, float &tc, OpenList open) {
+    SearchResult r = bestFirstSearch(g, s, e, GridEdges{g}, [](int t) { return getWeight(t); }, ZeroHeuristic(), open);
+    nodes_opened += r.closed;
+    tc = r.cost < 0 ? INFINITY : float(r.cost);
+    vector<Coordinate> path;
+    for (int id : r.path) path.push_back(g.coord(id));
+    return path;
+}
+
+vector<Coordinate> ucs(const Grid &g, int s, int e, float &tc) { return ucsWith(g, s, e, tc, HeapOpenList()); }
+
+int maxWeight() {
+    int m = 1;
+    for (int t = 0; t <= 9; t++) if (getWeight(t) != INT_MAX) m = max(m, getWeight(t));
+    return m;
+}
+
+// Dial's algorithm: ucs() on integer costs with a bucket queue of maxWeight() + 1
+// buckets instead of a binary heap. Opens nodes in the same cost order.
+vector<Coordinate> ucsBuckets(const Grid &g, int s, int e, float &tc) {
+    return ucsWith(g, s, e, tc, BucketOpenList(maxWeight()));
+}
+
+// Bidirectional Dijkstra. Entering a cell costs its terrain weight, so edges
+// are directed: u -> v costs getWeight(g[v]) whichever side relaxes it, and
+// the search from e charges the weight of the cell it comes from. A cell can
+// only be a predecessor if the forward search could leave it, which means s
+// or a cell with a finite weight. best is the cheapest s-e cost through a
+// cell labelled by both sides. The search stops once top_f + top_b >= best.
+vector<Coordinate> ucsBidirectional(const Grid &g, int s, int e, float &tc) {
+    using Item = pair<int, int>;
+    const int INF = INT_MAX / 2;
+    int V = g.size();
+    vector<int> dist[2] = {vector<int>(V, INF), vector<int>(V, INF)};
+    vector<int> link[2] = {vector<int>(V, -1), vector<int>(V, -1)};
+    vector<char> settled(V, 0);
+    priority_queue<Item, vector<Item>, greater<Item>> pq[2];
+    dist[0][s] = 0; pq[0].push({0, s});
+    dist[1][e] = 0; pq[1].push({0, e});
+    int best = s == e ? 0 : INF, meet = s == e ? s : -1;
+    while (!pq[0].empty() && !pq[1].empty()) {
+        if (pq[0].top().first + pq[1].top().first >= best) break;
+        int side = pq[0].top().first <= pq[1].top().first ? 0 : 1;
+        int u = pq[side].top().second; pq[side].pop();
+        if (settled[u] & (1 << side)) continue;
+        if (!settled[u]) nodes_opened++;
+        settled[u] |= 1 << side;
+        forEachNeighbor(g, u, [&](int v) {
+            int w = getWeight(g[side == 0 ? v : u]);
+            if (w == INT_MAX) return;
+            if (side == 1 && v != s && getWeight(g[v]) == INT_MAX) return;
+            int nd = dist[side][u] + w;
+            if (nd < dist[side][v]) {
+                dist[side][v] = nd; link[side][v] = u; pq[side].push({nd, v});
+                if (nd + dist[1 - side][v] < best) { best = nd + dist[1 - side][v]; meet = v; }
+            }
+        });
     }
-    tc = cost[e];
+    tc = best == INF ? INFINITY : float(best);
     vector<Coordinate> path;
-    if (from[e] != -1 || s == e) {
-        for (int cur = e; cur != -1; cur = from[cur])
-            path.push_back({cur % X, cur / X});
+    if (meet != -1) {
+        for (int cur = meet; cur != -1; cur = link[0][cur])
+            path.push_back(g.coord(cur));
         reverse(path.begin(), path.end());
+        for (int cur = link[1][meet]; cur != -1; cur = link[1][cur])
+            path.push_back(g.coord(cur));
     }
     return path;
 }
 
+// Query on the contraction hierarchy of the map. Nodes opened counts the
+// cells settled by its two upward searches.
+vector<Coordinate> ucsContracted(const Grid &g, int s, int e, float &tc) {
+    vector<int> ids;
+    long long cost = ch.query(s, e, ids);
+    nodes_opened += ch.settled();
+    tc = cost < 0 ? INFINITY : float(cost);
+    vector<Coordinate> path;
+    for (int id : ids) path.push_back(g.coord(id));
+    return path;
+}
+
 void printMemoryUsage() {
     PROCESS_MEMORY_COUNTERS_EX pmc;
     GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
@@ -90,17 +144,18 @@ void printMemoryUsage() {
     cout << "Memory usage: " << memUsed / (1024.0 * 1024.0) << " MB\n";
 }
 
-int main() {
+int main(int argc, char **argv) {
     auto start = chrono::high_resolution_clock::now();
 
-    int X, Y, s = -1, e = -1;
-    vector<vector<int>> g;
+    int s = -1, e = -1;
+    Grid g;
 
-    if (!readGrid(GRID_FILE, X, Y, g, s, e)) return 1;
+    if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, g, s, e)) return 1;
     if (s == -1 || e == -1) return 1;
 
     float total_cost = 0;
-    auto path = ucs(g, X, Y, s, e, total_cost);
+    auto search = CONTRACTION_HIERARCHY ? ucsContracted : BIDIRECTIONAL_UCS ? ucsBidirectional : BUCKET_QUEUE ? ucsBuckets : ucs;
+    auto path = search(g, s, e, total_cost);
     if (path.empty()) { cout << "No path found.\n"; return 0; }
 
     cout << "Shortest path (UCS):\n";
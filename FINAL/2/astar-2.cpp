@@ -1,43 +1,70 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <queue>
 #include <climits>
 #include <algorithm>
 #include <string>
 #include <cmath>
 #include <functional>
+#include <map>
+#include <type_traits>
 #include <chrono>
+#include <atomic>
+#include <thread>
 #include <windows.h>
 #include <psapi.h>
+#include "../common/grid_io.h"
+#include "../common/bucket_queue.h"
+#include "../common/indexed_heap.h"
+#include "../common/hpa.h"
+#include "../common/heuristics.h"
+#include "../common/search.h"
+#include "../common/ms_bfs.h"
+#include "../common/tour.h"
 
 using namespace std;
 
 #define GRID_FILE "grid.txt"
+#define FIELD_CACHE_DIR "field-cache"
+#define FIELD_CACHE_MAX_MB 1024ull
 constexpr int POKEMON_NUM = 3;
 
 const bool COLLECT_POKEMON = true;
-// Jika SIMPLE_HEURISTIC = true, maka A* Euclidean/Simple.
-// Jika SIMPLE_HEURISTIC = false, maka A* Dijkstra/Complex.
-const bool SIMPLE_HEURISTIC = false;
+// Jika BUCKET_OPEN_LIST = true, open list A* memakai bucket f/g (FgBucketQueue),
+// selain itu priority_queue biasa. Urutan f lalu g terbesar tetap sama.
+const bool BUCKET_OPEN_LIST = false;
+// Jika HIERARCHICAL = true, astar() mencari lewat graf abstrak HPA* (HierarchicalMap)
+// dengan cluster HPA_CLUSTER x HPA_CLUSTER. Hasilnya mendekati optimal; HPA_EXACT = true
+// menjadikan setiap sel batas pintu masuk sehingga hasilnya optimal.
+const bool HIERARCHICAL = false;
+const int HPA_CLUSTER = 16;
+const bool HPA_EXACT = false;
+// Heuristic = policy heuristik A* (common/heuristics.h), dihitung per node saat dibuka:
+//   ZeroHeuristic       h = 0, sama dengan UCS
+//   ManhattanHeuristic  jarak Manhattan x biaya langkah termurah di peta
+//   EuclideanHeuristic  jarak Euclidean x biaya langkah termurah (dulu SIMPLE_HEURISTIC)
+//   TableHeuristic      medan Dijkstra dari target, computeHeuristicDijkstra()
+//   MappedHeuristic     medan Dijkstra lewat cache FIELD_CACHE_DIR (nama = hash peta + goal, mmap)
+//                       cache dibatasi FIELD_CACHE_MAX_MB; medan peta lain yang paling lama tak dipakai dihapus
+//   LandmarkHeuristic   batas segitiga ALT dari LANDMARK_COUNT landmark, disimpan di <grid>.alt
+using Heuristic = TableHeuristic;
+const int LANDMARK_COUNT = 8;
+// Di mode COLLECT_POKEMON, TableHeuristic/MappedHeuristic memakai medan menuju target leg
+// itu sendiri (Pokemon atau G), sama seperti policy lain; medan semua target dihitung
+// sekali sebelum leg pertama, paralel dengan std::thread.
+// Jika HELD_KARP_TOUR = true, urutan Pokemon di mode COLLECT_POKEMON dipilih optimal
+// dengan DP bitmask Held-Karp atas biaya Dijkstra antara S, setiap Pokemon dan G,
+// bukan Pokemon terdekat secara Euclidean.
+const bool HELD_KARP_TOUR = false;
 
-struct Coordinate
-{
-    int x, y;
-};
-
-struct PQItem
-{
-    long long f;
-    long long g;
-    int id;
-    bool operator<(PQItem const &other) const
-    {
-        if (f != other.f)
-            return f > other.f;
-        return g < other.g;
-    }
-};
+HierarchicalMap hpa;
+Landmarks landmarks;
+// State of the Heuristic policy, filled by prepareHeuristics(): the field of
+// each target for the field policies, and the cheapest step for the
+// analytic ones.
+map<int, vector<long long>> heuristic_tables;
+map<int, DistanceField> heuristic_fields;
+int heuristic_fallback = -1;
+long long min_step = 1;
 
 inline long long cellCost(int cellVal)
 {
@@ -59,230 +86,197 @@ inline long long cellCost(int cellVal)
     }
 }
 
-bool readGrid(const string &filename, int &X, int &Y, vector<vector<int>> &grid, int &start_id, int &goal_id)
+// Loads the landmark tables cached next to the map file, or builds them and
+// writes the cache for the next run.
+void prepareLandmarks(const string &filename, const Grid &grid)
 {
-    ifstream gridFile(filename);
-    if (!gridFile.is_open())
+    string error;
+    if (landmarks.load(filename + ".alt", grid, nullptr, cellCost, error) && landmarks.count() == LANDMARK_COUNT)
+        return;
+    landmarks.build(grid, nullptr, LANDMARK_COUNT, cellCost);
+    if (!landmarks.save(filename + ".alt", error))
+        cerr << error << "\n";
+}
+
+bool readGrid(const string &filename, Grid &grid, int &start_id, int &goal_id, vector<Coordinate> &pokemons)
+{
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(filename, grid, start_id, goal_id, pokemons, tunnels, error))
+    {
+        cerr << error << "\n";
         return false;
-    gridFile >> X >> Y;
-    grid.assign(Y, vector<int>(X));
-    start_id = -1;
-    goal_id = -1;
-    auto id = [X](int x, int y)
-    { return y * X + x; };
-    for (int y = 0; y < Y; ++y)
-        for (int x = 0; x < X; ++x)
-        {
-            string t;
-            gridFile >> t;
-            if (t == "S")
-            {
-                grid[y][x] = 1;
-                start_id = id(x, y);
-            }
-            else if (t == "G")
-            {
-                grid[y][x] = 1;
-                goal_id = id(x, y);
-            }
-            else if (t == "P")
-            {
-                grid[y][x] = 1;
-            }
-            else
-            {
-                grid[y][x] = stoi(t);
-            }
-        }
-    gridFile.close();
+    }
+    if (HIERARCHICAL)
+        hpa.build(grid, nullptr, HPA_CLUSTER, HPA_EXACT, cellCost);
+    if (is_same_v<Heuristic, LandmarkHeuristic>)
+        prepareLandmarks(filename, grid);
     return true;
 }
 
-vector<long long> computeHeuristicDijkstra(const vector<vector<int>> &grid, int X, int Y, int goal_id)
+vector<long long> computeHeuristicDijkstra(const Grid &grid, int goal_id)
 {
-    int V = X * Y;
+    int V = grid.size();
     const long long INF = LLONG_MAX / 4;
     vector<long long> dist(V, INF);
     if (goal_id < 0)
         return dist;
-    int gx = goal_id % X, gy = goal_id / X;
-    if (cellCost(grid[gy][gx]) == INF)
+    if (cellCost(grid[goal_id]) == INF)
         return dist;
-    auto id = [X](int x, int y)
-    { return y * X + x; };
-    using PLL = pair<long long, int>;
-    priority_queue<PLL, vector<PLL>, greater<PLL>> pq;
+    IndexedHeap<long long> pq(V);
     dist[goal_id] = 0;
-    pq.push({0, goal_id});
+    pq.push(goal_id, 0);
     while (!pq.empty())
     {
-        auto cur = pq.top();
-        pq.pop();
-        long long d = cur.first;
-        int u = cur.second;
-        if (d != dist[u])
-            continue;
-        int ux = u % X, uy = u / X;
-        if (uy > 0)
-        {
-            int v = id(ux, uy - 1);
-            long long w = cellCost(grid[uy - 1][ux]);
-            if (w != INF && dist[v] > dist[u] + w)
-            {
-                dist[v] = dist[u] + w;
-                pq.push({dist[v], v});
-            }
-        }
-        if (ux > 0)
+        long long d;
+        int u = pq.pop(d);
+        forEachNeighbor(grid, u, [&](int v)
         {
-            int v = id(ux - 1, uy);
-            long long w = cellCost(grid[uy][ux - 1]);
-            if (w != INF && dist[v] > dist[u] + w)
+            long long w = cellCost(grid[v]);
+            if (dist[v] > dist[u] + w)
             {
                 dist[v] = dist[u] + w;
-                pq.push({dist[v], v});
+                pq.push(v, dist[v]);
             }
-        }
-        if (uy + 1 < Y)
-        {
-            int v = id(ux, uy + 1);
-            long long w = cellCost(grid[uy + 1][ux]);
-            if (w != INF && dist[v] > dist[u] + w)
-            {
-                dist[v] = dist[u] + w;
-                pq.push({dist[v], v});
-            }
-        }
-        if (ux + 1 < X)
-        {
-            int v = id(ux + 1, uy);
-            long long w = cellCost(grid[uy][ux + 1]);
-            if (w != INF && dist[v] > dist[u] + w)
-            {
-                dist[v] = dist[u] + w;
-                pq.push({dist[v], v});
-            }
-        }
+        });
     }
     return dist;
 }
 
-vector<long long> computeHeuristicEuclidean(const vector<vector<int>> &grid, int width, int height, int goalId)
+// computeHeuristicDijkstra() through the field cache: maps the field stored
+// for this map (fingerprint) and goal, or computes and stores it first.
+void openHeuristicField(const Grid &grid, uint64_t fingerprint, int goal_id, DistanceField &field)
 {
-    const long long INF = LLONG_MAX / 4;
-    vector<long long> heuristic(width * height, INF);
-    if (goalId < 0)
-        return heuristic;
-    int goalX = goalId % width;
-    int goalY = goalId / width;
-    if (cellCost(grid[goalY][goalX]) == INF)
-        return heuristic;
-    long long minCost = LLONG_MAX;
-    for (int y = 0; y < height; ++y)
-        for (int x = 0; x < width; ++x)
-        {
-            long long c = cellCost(grid[y][x]);
-            if (c < minCost)
-                minCost = c;
-        }
-    if (minCost <= 0 || minCost >= LLONG_MAX / 4)
-        minCost = 1;
-    auto index = [width](int x, int y)
-    { return y * width + x; };
-    for (int y = 0; y < height; ++y)
-        for (int x = 0; x < width; ++x)
-        {
-            long long c = cellCost(grid[y][x]);
-            if (c == INF)
-                continue;
-            double dx = x - goalX;
-            double dy = y - goalY;
-            double dist = sqrt(dx * dx + dy * dy);
-            long long scaled = static_cast<long long>(ceil(dist * double(minCost)));
-            heuristic[index(x, y)] = scaled;
-        }
-    return heuristic;
+    string error;
+    if (field.open(FIELD_CACHE_DIR, grid, fingerprint, goal_id, error))
+        return;
+    if (!field.store(FIELD_CACHE_DIR, grid, fingerprint, goal_id, computeHeuristicDijkstra(grid, goal_id), error))
+        cerr << error << "\n";
 }
 
-long long total_nodes_opened = 0;
-
-vector<Coordinate> astar(const vector<vector<int>> &grid, const vector<long long> &heuristic, int X, int Y, int start_id, int goal_id)
+// Sets up the Heuristic policy for legs toward the given targets. The field
+// policies get the field of every target, computed by up to one thread per
+// hardware thread taking targets off a shared counter; legs toward a cell
+// without its own field use the field of the last target. The cached fields
+// are keyed by the map fingerprint, hashed once here for all targets; fields
+// of other maps are pruned afterwards. The analytic policies only need the
+// cheapest step on the map.
+void prepareHeuristics(const Grid &grid, vector<int> targets)
 {
-    int V = X * Y;
-    const long long INF = LLONG_MAX / 4;
-    vector<long long> g(V, INF), f(V, INF);
-    vector<int> from(V, -1);
-    vector<char> closed(V, 0);
-    priority_queue<PQItem> open;
-    auto id = [X](int x, int y)
-    { return y * X + x; };
-    auto neighbors = [&](int node)
-    {
-        int x = node % X, y = node / X;
-        vector<int> n;
-        if (y > 0)
-            n.push_back(id(x, y - 1));
-        if (x > 0)
-            n.push_back(id(x - 1, y));
-        if (y + 1 < Y)
-            n.push_back(id(x, y + 1));
-        if (x + 1 < X)
-            n.push_back(id(x + 1, y));
-        return n;
-    };
-    g[start_id] = 0;
-    f[start_id] = (heuristic[start_id] == INF) ? 0 : heuristic[start_id];
-    open.push({f[start_id], g[start_id], start_id});
-    while (!open.empty())
+    if (is_same_v<Heuristic, ManhattanHeuristic> || is_same_v<Heuristic, EuclideanHeuristic>)
+        min_step = minStepCost(grid, cellCost);
+    constexpr bool tables = is_same_v<Heuristic, TableHeuristic>;
+    if (!tables && !is_same_v<Heuristic, MappedHeuristic>)
+        return;
+    heuristic_fallback = targets.back();
+    sort(targets.begin(), targets.end());
+    targets.erase(unique(targets.begin(), targets.end()), targets.end());
+    for (int t : targets)
+        if (tables)
+            heuristic_tables[t];
+        else
+            heuristic_fields[t];
+    uint64_t fingerprint = 0;
+    if (!tables)
     {
-        auto cur = open.top();
-        open.pop();
-        int u = cur.id;
-        if (closed[u])
-        {
-            if (cur.g > g[u])
-                continue;
-        }
-        if (u == goal_id)
-        {
-            closed[u] = 1;
-            total_nodes_opened++;
-            break;
-        }
-        if (closed[u] == 0)
-        {
-            closed[u] = 1;
-            total_nodes_opened++;
-        }
-        for (int v : neighbors(u))
-        {
-            int vx = v % X, vy = v / X;
-            long long w = cellCost(grid[vy][vx]);
-            if (w == INF)
-                continue;
-            if (g[u] == INF)
-                continue;
-            long long tentative = g[u] + w;
-            if (tentative < g[v])
-            {
-                from[v] = u;
-                g[v] = tentative;
-                long long h = (heuristic[v] == INF) ? 0 : heuristic[v];
-                f[v] = tentative + h;
-                open.push({f[v], g[v], v});
-                if (closed[v])
-                    closed[v] = 0;
-            }
-        }
+        int costs[TERRAINS];
+        costTable(cellCost, costs);
+        fingerprint = mapFingerprint(grid, nullptr, costs);
     }
+    atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        for (size_t i; (i = next++) < targets.size();)
+            if (tables)
+                heuristic_tables.at(targets[i]) = computeHeuristicDijkstra(grid, targets[i]);
+            else
+                openHeuristicField(grid, fingerprint, targets[i], heuristic_fields.at(targets[i]));
+    };
+    size_t count = min<size_t>(targets.size(), max(1u, thread::hardware_concurrency()));
+    vector<thread> workers;
+    for (size_t t = 1; t < count; ++t)
+        workers.emplace_back(work);
+    work();
+    for (auto &w : workers)
+        w.join();
+    if (!tables)
+        pruneFieldCache(FIELD_CACHE_DIR, fingerprint, FIELD_CACHE_MAX_MB << 20);
+}
+
+template <typename Fields>
+const typename Fields::mapped_type &fieldToward(const Fields &fields, int goal_id)
+{
+    auto it = fields.find(goal_id);
+    return it != fields.end() ? it->second : fields.at(heuristic_fallback);
+}
+
+// The Heuristic policy bound to goal_id.
+template <typename H = Heuristic>
+H heuristicToward(const Grid &grid, int goal_id)
+{
+    if constexpr (is_same_v<H, ZeroHeuristic>)
+        return H();
+    else if constexpr (is_same_v<H, ManhattanHeuristic> || is_same_v<H, EuclideanHeuristic>)
+        return H(grid, goal_id, min_step);
+    else if constexpr (is_same_v<H, LandmarkHeuristic>)
+        return H(landmarks, goal_id);
+    else if constexpr (is_same_v<H, TableHeuristic>)
+        return H(fieldToward(heuristic_tables, goal_id));
+    else
+        return H(fieldToward(heuristic_fields, goal_id));
+}
+
+long long total_nodes_opened = 0;
+long long total_stale_entries = 0;
+
+// A* on the shared search loop: heuristic(v) estimates the cost from v to
+// goal_id, NO_BOUND counts as 0.
+template <typename OpenList, typename H>
+vector<Coordinate> astarWith(const Grid &grid, H heuristic, int start_id, int goal_id)
+{
+    SearchResult found = bestFirstSearch<OpenList>(grid, start_id, goal_id, GridEdges{grid},
+                                                   [](int t) { return cellCost(t); }, heuristic);
+    total_nodes_opened += found.closed;
+    total_stale_entries += found.stale;
     vector<Coordinate> path;
-    if (from[goal_id] != -1 || start_id == goal_id)
+    for (int id : found.path)
+        path.push_back(grid.coord(id));
+    return path;
+}
+
+vector<Coordinate> astar(const Grid &grid, int start_id, int goal_id)
+{
+    if (HIERARCHICAL)
     {
-        for (int cur = goal_id; cur != -1; cur = from[cur])
-            path.push_back({cur % X, cur / X});
-        reverse(path.begin(), path.end());
+        long long cost;
+        vector<int> ids = hpa.path(start_id, goal_id, cost);
+        total_nodes_opened += hpa.opened();
+        vector<Coordinate> path;
+        for (int id : ids)
+            path.push_back(grid.coord(id));
+        return path;
     }
-    return path;
+    Heuristic heuristic = heuristicToward(grid, goal_id);
+    if (BUCKET_OPEN_LIST)
+        return astarWith<FgBucketQueue>(grid, heuristic, start_id, goal_id);
+    return astarWith<FgHeapOpenList>(grid, heuristic, start_id, goal_id);
+}
+
+// Cheapest order to collect pokemons[0 .. count - 1], by Held-Karp over the
+// costs between S, G and the Pokemon, one Dijkstra from each. Returns false,
+// for the greedy order, when there are too many Pokemon.
+bool heldKarpTour(const Grid &grid, int start_id, int goal_id, const Coordinate *pokemons, int count, vector<int> &order)
+{
+    CostMatrix matrix;
+    vector<Coordinate> targets(pokemons, pokemons + count);
+    matrix.build(grid, pointsOfInterest(grid, start_id, goal_id, targets, {}), GridEdges{grid},
+                 [](int t) { return cellCost(t); }, HeapOpenList());
+    total_nodes_opened += matrix.closed();
+    string error;
+    if (heldKarpOrder(count, [&](int a, int b) { return matrix.at(a, b); }, order, error))
+        return true;
+    cerr << error << "\n";
+    return false;
 }
 
 void printPath(const vector<Coordinate> &path)
@@ -292,7 +286,6 @@ void printPath(const vector<Coordinate> &path)
         cout << c.x << "," << c.y << ":";
 }
 
-inline int getID(int X, int x, int y) { return y * X + x; }
 inline float eucledian(int x1, int y1, int x2, int y2) { return sqrtf(float(x1 - x2) * float(x1 - x2) + float(y1 - y2) * float(y1 - y2)); }
 
 void printMemoryUsage() {
@@ -302,7 +295,7 @@ void printMemoryUsage() {
     cout << "Memory usage: " << memUsed / (1024.0 * 1024.0) << " MB\n";
 }
 
-int main() {
+int main(int argc, char **argv) {
     auto start = chrono::high_resolution_clock::now();
 
     long long total_steps = 0;
@@ -310,22 +303,18 @@ int main() {
 
     if (!COLLECT_POKEMON)
     {
-        int X, Y;
-        vector<vector<int>> grid;
+        Grid grid;
         int start_id, goal_id;
-        if (!readGrid(GRID_FILE, X, Y, grid, start_id, goal_id))
+        vector<Coordinate> pokemon_list;
+        if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, grid, start_id, goal_id, pokemon_list))
             return 1;
-        int V = X * Y;
         if (start_id == -1)
-            start_id = 0;
+            start_id = grid.id(0, 0);
         if (goal_id == -1)
-            goal_id = V - 1;
-        vector<long long> heuristic;
-        if (SIMPLE_HEURISTIC)
-            heuristic = computeHeuristicEuclidean(grid, X, Y, goal_id);
-        else
-            heuristic = computeHeuristicDijkstra(grid, X, Y, goal_id);
-        vector<Coordinate> path = astar(grid, heuristic, X, Y, start_id, goal_id);
+            goal_id = grid.id(grid.X - 1, grid.Y - 1);
+        if (!HIERARCHICAL) // HPA* bounds its abstract search itself
+            prepareHeuristics(grid, {goal_id});
+        vector<Coordinate> path = astar(grid, start_id, goal_id);
         printPath(path);
         if (!path.empty())
         {
@@ -335,7 +324,7 @@ int main() {
             {
                 int px = path[i].x;
                 int py = path[i].y;
-                long long w = cellCost(grid[py][px]);
+                long long w = cellCost(grid[grid.id(px, py)]);
                 if (w < LLONG_MAX / 4)
                     weight_total += w;
             }
@@ -345,6 +334,7 @@ int main() {
         cout << "\nTotal steps: " << total_steps;
         cout << "\nTotal nodes opened: " << total_nodes_opened;
         cout << "\nTotal weight: " << total_weight;
+        cout << "\nStale open-list entries: " << total_stale_entries;
 
         auto end = chrono::high_resolution_clock::now();
         chrono::duration<double> duration = end - start;
@@ -355,68 +345,48 @@ int main() {
     }
     else
     {
-        ifstream gridFile(GRID_FILE);
-        if (!gridFile.is_open())
+        Grid grid;
+        int start_id, goal_id;
+        vector<Coordinate> pokemon_list;
+        if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, grid, start_id, goal_id, pokemon_list))
             return 1;
-        int X, Y;
-        gridFile >> X >> Y;
-        vector<vector<int>> grid(Y, vector<int>(X));
-        int start_id = -1, goal_id = -1;
-        auto id = [X](int x, int y)
-        { return y * X + x; };
         Coordinate pokemons[POKEMON_NUM];
         int collected_pokemons[POKEMON_NUM];
         int poke_i = 0;
         for (int i = 0; i < POKEMON_NUM; i++)
             collected_pokemons[i] = 0;
-        for (int y = 0; y < Y; ++y)
-            for (int x = 0; x < X; ++x)
-            {
-                string t;
-                gridFile >> t;
-                if (t == "S")
-                {
-                    grid[y][x] = 1;
-                    start_id = id(x, y);
-                }
-                else if (t == "G")
-                {
-                    grid[y][x] = 1;
-                    goal_id = id(x, y);
-                }
-                else if (t == "P")
-                {
-                    grid[y][x] = 1;
-                    Coordinate poke_cor = {x, y};
-                    if (poke_i < POKEMON_NUM)
-                        pokemons[poke_i++] = poke_cor;
-                }
-                else
-                {
-                    grid[y][x] = stoi(t);
-                }
-            }
-        gridFile.close();
-        int V = X * Y;
+        for (auto &poke_cor : pokemon_list)
+            if (poke_i < POKEMON_NUM)
+                pokemons[poke_i++] = poke_cor;
         if (start_id == -1)
-            start_id = 0;
+            start_id = grid.id(0, 0);
         if (goal_id == -1)
-            goal_id = V - 1;
-        vector<long long> heuristic;
-        if (SIMPLE_HEURISTIC)
-            heuristic = computeHeuristicEuclidean(grid, X, Y, goal_id);
-        else
-            heuristic = computeHeuristicDijkstra(grid, X, Y, goal_id);
+            goal_id = grid.id(grid.X - 1, grid.Y - 1);
+        if (!HIERARCHICAL) // HPA* bounds its abstract search itself
+        {
+            vector<int> targets;
+            for (int j = 0; j < poke_i; j++)
+                targets.push_back(grid.id(pokemons[j].x, pokemons[j].y));
+            targets.push_back(goal_id);
+            prepareHeuristics(grid, targets);
+        }
+        vector<int> order;
+        bool tour = HELD_KARP_TOUR && heldKarpTour(grid, start_id, goal_id, pokemons, poke_i, order);
         Coordinate current;
         cout << "Shortest path visiting all Pokemons (A*):\n";
-        current = {start_id % X, start_id / X};
+        current = grid.coord(start_id);
         cout << current.x << "," << current.y << ":";
         for (int i = 0; i < POKEMON_NUM; i++)
         {
             Coordinate closest_pokemon;
             int closest_pokemon_id = -1;
             float closest_pokemon_dist = -1.0;
-            for (int j = 0; j < poke_i; j++)
+            if (tour && i < (int)order.size())
+            {
+                closest_pokemon_id = order[i];
+                closest_pokemon = pokemons[closest_pokemon_id];
+            }
+            for (int j = 0; !tour && j < poke_i; j++)
             {
                 if (collected_pokemons[j] == 0)
                 {
@@ -440,7 +410,7 @@ int main() {
             }
             if (closest_pokemon_id == -1)
                 break;
-            vector<Coordinate> path = astar(grid, heuristic, X, Y, getID(X, current.x, current.y), getID(X, closest_pokemon.x, closest_pokemon.y));
+            vector<Coordinate> path = astar(grid, grid.id(current.x, current.y), grid.id(closest_pokemon.x, closest_pokemon.y));
             for (auto &c : path)
                 cout << c.x << "," << c.y << ":";
             if (!path.empty())
@@ -451,7 +421,7 @@ int main() {
                 {
                     int px = path[ii].x;
                     int py = path[ii].y;
-                    long long w = cellCost(grid[py][px]);
+                    long long w = cellCost(grid[grid.id(px, py)]);
                     if (w < LLONG_MAX / 4)
                         weight_total += w;
                 }
@@ -467,7 +437,7 @@ int main() {
             }
             collected_pokemons[closest_pokemon_id] = 1;
         }
-        vector<Coordinate> path = astar(grid, heuristic, X, Y, getID(X, current.x, current.y), goal_id);
+        vector<Coordinate> path = astar(grid, grid.id(current.x, current.y), goal_id);
         for (auto &c : path)
             cout << c.x << "," << c.y << ":";
         if (!path.empty())
@@ -478,7 +448,7 @@ int main() {
             {
                 int px = path[ii].x;
                 int py = path[ii].y;
-                long long w = cellCost(grid[py][px]);
+                long long w = cellCost(grid[grid.id(px, py)]);
                 if (w < LLONG_MAX / 4)
                     weight_total += w;
             }
@@ -488,6 +458,7 @@ int main() {
         cout << "\nTotal steps: " << total_steps;
         cout << "\nTotal nodes opened: " << total_nodes_opened;
         cout << "\nTotal weight: " << total_weight;
+        cout << "\nStale open-list entries: " << total_stale_entries;
 
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double> duration = end - start;
@@ -1,145 +1,179 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
-#include <queue>
 #include <climits>
 #include <algorithm>
 #include <string>
 #include <chrono>
 #include <windows.h>
 #include <psapi.h>
+#include "../common/grid_io.h"
+#include "../common/bitset_bfs.h"
+#include "../common/jps.h"
+#include "../common/search.h"
+#include "../common/ms_bfs.h"
+#include "../common/tour.h"
 
 using namespace std;
 
 #define GRID_FILE "grid.txt"
+// BIDIRECTIONAL_BFS = true: bfs() mencari dari start dan goal sekaligus (bfsBidirectional).
+const bool BIDIRECTIONAL_BFS = false;
+// BITSET_BFS = true: bfs() memakai BFS bit-parallel per level (BitsetBfs).
+const bool BITSET_BFS = false;
+// JUMP_POINT_SEARCH = true: bfs() memakai Jump Point Search 4-arah (JumpPointSearch);
+// JPS_PLUS = true menambahkan tabel jarak lompatan yang dihitung sekali di awal.
+const bool JUMP_POINT_SEARCH = false;
+const bool JPS_PLUS = false;
+// DISTANCE_MATRIX = true: jarak ke Pokemon diambil dari satu MS-BFS atas S, G, P
+// dan mulut terowongan (DistanceMatrix), bukan bfsDistance() per pasangan.
+const bool DISTANCE_MATRIX = false;
+// HELD_KARP_TOUR = true: urutan Pokemon dipilih optimal dengan DP bitmask Held-Karp
+// atas matriks jarak DistanceMatrix (paling banyak HELD_KARP_MAX Pokemon), bukan
+// Pokemon terdekat berikutnya.
+const bool HELD_KARP_TOUR = false;
+// TOUR_OPTIMIZER = true: untuk Pokemon yang terlalu banyak bagi Held-Karp, urutan
+// dimulai dari tetangga terdekat lalu diperbaiki 2-opt/Or-opt dengan restart acak
+// di semua thread (optimizeTour) selama TOUR_TIME_BUDGET detik.
+const bool TOUR_OPTIMIZER = false;
+const double TOUR_TIME_BUDGET = 1.0;
 constexpr int POKEMON_NUM = 3;
 
-struct Coordinate
-{
-    int x, y;
-};
-struct Node
-{
-    int id;
-};
-
+BitsetBfs bitbfs;
+JumpPointSearch jps;
 long long tiles_opened = 0;
 long long total_weight = 0;
 
-bool readGrid(const string &filename, int &X, int &Y, vector<vector<int>> &grid, int &start_id, int &goal_id, vector<Coordinate> &pokemons)
+bool readGrid(const string &filename, Grid &grid, int &start_id, int &goal_id, vector<Coordinate> &pokemons)
 {
-    ifstream gridFile(filename);
-    if (!gridFile.is_open())
-        return false;
-    gridFile >> X >> Y;
-    grid.assign(Y, vector<int>(X));
-    start_id = -1;
-    goal_id = -1;
-    auto id = [X](int x, int y)
-    { return y * X + x; };
-    for (int y = 0; y < Y; ++y)
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(filename, grid, start_id, goal_id, pokemons, tunnels, error))
     {
-        for (int x = 0; x < X; ++x)
-        {
-            string t;
-            gridFile >> t;
-            if (t == "S")
-            {
-                grid[y][x] = 1;
-                start_id = id(x, y);
-            }
-            else if (t == "G")
-            {
-                grid[y][x] = 1;
-                goal_id = id(x, y);
-            }
-            else if (t == "P")
-            {
-                grid[y][x] = 1;
-                pokemons.push_back({x, y});
-            }
-            else
-            {
-                grid[y][x] = atoi(t.c_str());
-            }
-        }
+        cerr << error << "\n";
+        return false;
     }
-    gridFile.close();
+    if (BITSET_BFS)
+        bitbfs.build(grid);
+    if (JUMP_POINT_SEARCH)
+        jps.build(grid, nullptr, JPS_PLUS);
     return true;
 }
 
-vector<Coordinate> bfs(const vector<vector<int>> &grid, int X, int Y, int start_id, int goal_id)
+// Coordinates of a path given as cell ids from start to goal; adds the
+// weight of every cell on it, start included, to total_weight.
+vector<Coordinate> walkPath(const Grid &grid, const vector<int> &ids)
 {
-    int V = X * Y;
-    vector<int> from(V, -1);
-    vector<char> visited(V, 0);
-    auto id = [X](int x, int y)
-    { return y * X + x; };
-    auto neighbors = [&](int node)
+    vector<Coordinate> path;
+    for (int cur : ids)
     {
-        int x = node % X, y = node / X;
-        vector<int> n;
-        if (y > 0)
-            n.push_back(id(x, y - 1));
-        if (x > 0)
-            n.push_back(id(x - 1, y));
-        if (y + 1 < Y)
-            n.push_back(id(x, y + 1));
-        if (x + 1 < X)
-            n.push_back(id(x + 1, y));
-        return n;
-    };
-    queue<Node> q;
-    q.push({start_id});
-    visited[start_id] = 1;
+        int w = 0;
+        if (grid[cur] == 1)
+            w = 2;
+        else if (grid[cur] == 2)
+            w = 1;
+        else if (grid[cur] == 3)
+            w = 3;
+        else if (grid[cur] == 4)
+            w = 5;
+        total_weight += w;
+        path.push_back(grid.coord(cur));
+    }
+    return path;
+}
+
+// Meet-in-the-middle BFS. Grows one whole level at a time from start_id or
+// from goal_id, whichever frontier is smaller. Moves between passable cells
+// go both ways, so the goal side walks the same
+// edges backwards. Each cell belongs to the side that reached it first:
+// depth[v] is d + 1 for the start side and -(d + 1) for the goal side. The
+// first level that touches the other side is finished to find the shortest
+// joint, and the search stops there.
+vector<Coordinate> bfsBidirectional(const Grid &grid, int start_id, int goal_id)
+{
+    int V = grid.size();
+    vector<int> from(V, -1);
+    vector<int> depth(V, 0);
+    vector<int> frontier[2] = {{start_id}, {goal_id}};
+    depth[start_id] = 1;
     tiles_opened++;
-    while (!q.empty())
+    int best = INT_MAX, meet_s = -1, meet_g = -1;
+    if (start_id == goal_id)
     {
-        Node cur = q.front();
-        q.pop();
-        if (cur.id == goal_id)
-            break;
-        for (int v : neighbors(cur.id))
-        {
-            int vx = v % X, vy = v / X;
-            if (grid[vy][vx] == 5)
-                continue;
-            if (visited[v])
-                continue;
-            visited[v] = 1;
-            tiles_opened++;
-            from[v] = cur.id;
-            q.push({v});
-        }
+        best = 0;
+        meet_s = start_id;
     }
-    vector<Coordinate> path;
-    if (from[goal_id] != -1 || start_id == goal_id)
+    else
     {
-        for (int cur = goal_id; cur != -1; cur = from[cur])
+        depth[goal_id] = -1;
+        tiles_opened++;
+    }
+    while (best == INT_MAX && !frontier[0].empty() && !frontier[1].empty())
+    {
+        int side = frontier[0].size() <= frontier[1].size() ? 0 : 1;
+        int sign = side == 0 ? 1 : -1;
+        vector<int> next;
+        for (int u : frontier[side])
         {
-            int x = cur % X, y = cur / X;
-            int w = 0;
-            if (grid[y][x] == 1)
-                w = 2;
-            else if (grid[y][x] == 2)
-                w = 1;
-            else if (grid[y][x] == 3)
-                w = 3;
-            else if (grid[y][x] == 4)
-                w = 5;
-            total_weight += w;
-            path.push_back({x, y});
+            int du = depth[u] * sign;
+            forEachNeighbor(grid, u, [&](int v)
+            {
+                int dv = depth[v] * sign;
+                if (dv < 0)
+                {
+                    if (du - dv - 1 < best)
+                    {
+                        best = du - dv - 1;
+                        meet_s = side == 0 ? u : v;
+                        meet_g = side == 0 ? v : u;
+                    }
+                    return;
+                }
+                if (dv > 0)
+                    return;
+                depth[v] = (du + 1) * sign;
+                from[v] = u;
+                tiles_opened++;
+                next.push_back(v);
+            });
         }
-        reverse(path.begin(), path.end());
+        frontier[side].swap(next);
     }
-    return path;
+    vector<int> ids;
+    if (best != INT_MAX)
+    {
+        for (int cur = meet_s; cur != -1; cur = from[cur])
+            ids.push_back(cur);
+        reverse(ids.begin(), ids.end());
+        for (int cur = meet_g; cur != -1; cur = from[cur])
+            ids.push_back(cur);
+    }
+    return walkPath(grid, ids);
 }
 
-inline int correctID(int X, int x, int y) { return y * X + x; }
+vector<Coordinate> bfs(const Grid &grid, int start_id, int goal_id)
+{
+    if (BIDIRECTIONAL_BFS)
+        return bfsBidirectional(grid, start_id, goal_id);
+    if (BITSET_BFS)
+    {
+        vector<int> ids = bitbfs.path(start_id, goal_id);
+        tiles_opened += bitbfs.reached();
+        return walkPath(grid, ids);
+    }
+    if (JUMP_POINT_SEARCH)
+    {
+        vector<int> ids = jps.path(start_id, goal_id);
+        tiles_opened += jps.opened();
+        return walkPath(grid, ids);
+    }
+    SearchResult found = bestFirstSearch<FifoOpenList>(grid, start_id, goal_id, GridEdges{grid}, UnitCost());
+    tiles_opened += found.labelled;
+    return walkPath(grid, found.path);
+}
 
-int bfsDistance(const vector<vector<int>> &grid, int X, int Y, Coordinate a, Coordinate b)
+int bfsDistance(const Grid &grid, Coordinate a, Coordinate b)
 {
-    auto path = bfs(grid, X, Y, correctID(X, a.x, a.y), correctID(X, b.x, b.y));
+    auto path = bfs(grid, grid.id(a.x, a.y), grid.id(b.x, b.y));
     return path.empty() ? INT_MAX : (int)path.size() - 1;
 }
 
@@ -150,33 +184,68 @@ void printMemoryUsage() {
     cout << "Memory usage: " << memUsed / (1024.0 * 1024.0) << " MB\n";
 }
 
-int main() {
+int main(int argc, char **argv) {
     auto start = chrono::high_resolution_clock::now();
 
-    int X, Y;
-    vector<vector<int>> grid;
+    Grid grid;
     int start_id, goal_id;
     vector<Coordinate> pokemons;
-    if (!readGrid(GRID_FILE, X, Y, grid, start_id, goal_id, pokemons))
+    if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, grid, start_id, goal_id, pokemons))
         return 1;
-    int V = X * Y;
     if (start_id == -1)
-        start_id = 0;
+        start_id = grid.id(0, 0);
     if (goal_id == -1)
-        goal_id = V - 1;
+        goal_id = grid.id(grid.X - 1, grid.Y - 1);
+    DistanceMatrix poi;
+    int current_poi = 0;
+    double matrix_time = 0;
+    if (DISTANCE_MATRIX || HELD_KARP_TOUR || TOUR_OPTIMIZER)
+    {
+        auto matrix_start = chrono::high_resolution_clock::now();
+        poi.build(grid, nullptr, pointsOfInterest(grid, start_id, goal_id, pokemons, {}));
+        tiles_opened += poi.reached();
+        matrix_time = chrono::duration<double>(chrono::high_resolution_clock::now() - matrix_start).count();
+    }
+    vector<int> order;
+    bool tour = false;
+    TourStats tour_stats;
+    auto dist = [&](int a, int b) { return poi.at(a, b); };
+    if (HELD_KARP_TOUR)
+    {
+        string error;
+        tour = heldKarpOrder((int)pokemons.size(), dist, order, error);
+        if (tour)
+        {
+            tour_stats.greedy = tourCost(nearestNeighborOrder((int)pokemons.size(), dist), dist);
+            tour_stats.best = tourCost(order, dist);
+        }
+        else if (!TOUR_OPTIMIZER)
+            cerr << error << "\n";
+    }
+    if (TOUR_OPTIMIZER && !tour)
+    {
+        order = optimizeTour((int)pokemons.size(), dist, TOUR_TIME_BUDGET, tour_stats);
+        tour = true;
+    }
     vector<int> collected(pokemons.size(), 0);
-    Coordinate current = {start_id % X, start_id / X};
+    Coordinate current = grid.coord(start_id);
     vector<Coordinate> total_path;
     total_path.push_back(current);
     for (int i = 0; i < (int)pokemons.size(); i++)
     {
         int nearest_idx = -1;
         int nearest_dist = INT_MAX;
-        for (int j = 0; j < (int)pokemons.size(); j++)
+        if (tour)
+            nearest_idx = i < (int)order.size() ? order[i] : -1;
+        for (int j = 0; !tour && j < (int)pokemons.size(); j++)
         {
             if (collected[j])
                 continue;
-            int d = bfsDistance(grid, X, Y, current, pokemons[j]);
+            int d;
+            if (DISTANCE_MATRIX)
+                d = poi.at(current_poi, 2 + j) < 0 ? INT_MAX : poi.at(current_poi, 2 + j);
+            else
+                d = bfsDistance(grid, current, pokemons[j]);
             if (d < nearest_dist)
             {
                 nearest_dist = d;
@@ -185,15 +254,16 @@ int main() {
         }
         if (nearest_idx == -1)
             break;
-        auto path = bfs(grid, X, Y, correctID(X, current.x, current.y), correctID(X, pokemons[nearest_idx].x, pokemons[nearest_idx].y));
+        auto path = bfs(grid, grid.id(current.x, current.y), grid.id(pokemons[nearest_idx].x, pokemons[nearest_idx].y));
         if (!path.empty())
         {
             total_path.insert(total_path.end(), path.begin() + 1, path.end());
             current = path.back();
         }
         collected[nearest_idx] = 1;
+        current_poi = 2 + nearest_idx;
     }
-    auto path = bfs(grid, X, Y, correctID(X, current.x, current.y), goal_id);
+    auto path = bfs(grid, grid.id(current.x, current.y), goal_id);
     if (!path.empty())
         total_path.insert(total_path.end(), path.begin() + 1, path.end());
     cout << "Shortest path visiting all Pokemons (BFS):\n";
@@ -202,6 +272,12 @@ int main() {
     cout << "\nTotal steps: " << total_path.size() - 1 << "\n";
     cout << "Total tiles opened: " << tiles_opened << "\n";
     cout << "Total weight: " << total_weight << "\n";
+    if (tour)
+    {
+        cout << "Distance matrix time: " << matrix_time << " seconds\n";
+        cout << "Planned tour steps: " << tour_stats.best << " (greedy " << tour_stats.greedy << ", "
+             << tour_stats.restarts << " restarts)\n";
+    }
 
         auto end = chrono::high_resolution_clock::now();
         chrono::duration<double> duration = end - start;
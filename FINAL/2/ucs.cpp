@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <queue>
 #include <climits>
@@ -9,16 +8,39 @@
 #include <chrono>
 #include <windows.h>
 #include <psapi.h>
+#include "../common/grid_io.h"
+#include "../common/ch.h"
+#include "../common/search.h"
+#include "../common/ms_bfs.h"
+#include "../common/tour.h"
 
 using namespace std;
 
 #define GRID_FILE "grid.txt"
+// BUCKET_QUEUE = true: ucs() memakai algoritma Dial, antrian bucket sebanyak bobot
+// terbesar + 1 (BucketOpenList), bukan binary heap; urutan node dibuka tetap sama.
+// Matriks biaya HELD_KARP_TOUR/TOUR_OPTIMIZER juga memakai bucket.
+const bool BUCKET_QUEUE = false;
+// BIDIRECTIONAL_UCS = true: ucs() mencari dari start dan goal sekaligus (ucsBidirectional).
+const bool BIDIRECTIONAL_UCS = false;
+// CONTRACTION_HIERARCHY = true: ucs() menjawab lewat contraction hierarchy peta, dibangun
+// sekali lalu disimpan di <grid>.ch (ucsContracted). Didahulukan dari dua mode di atas.
+const bool CONTRACTION_HIERARCHY = false;
+// HELD_KARP_TOUR = true: urutan Pokemon dipilih optimal dengan DP bitmask Held-Karp
+// atas biaya Dijkstra antara S, setiap Pokemon dan G (CostMatrix), bukan Pokemon
+// termurah berikutnya.
+const bool HELD_KARP_TOUR = false;
+// TOUR_OPTIMIZER = true: untuk Pokemon yang terlalu banyak bagi Held-Karp, urutan
+// dimulai dari tetangga terdekat lalu diperbaiki 2-opt/Or-opt dengan restart acak
+// di semua thread (optimizeTour) selama TOUR_TIME_BUDGET detik.
+const bool TOUR_OPTIMIZER = false;
+const double TOUR_TIME_BUDGET = 1.0;
 constexpr int POKEMON_NUM = 3;
 
-struct Coordinate { int x, y; };
-struct Node { int id; float cost; bool operator>(const Node &o) const { return cost > o.cost; } };
-
 int nodes_opened = 0;
+double matrix_time = 0;
+TourStats tour_stats;
+ContractionHierarchy ch;
 
 int getWeight(int t) {
     if (t == 1) return 2;
@@ -28,64 +50,132 @@ int getWeight(int t) {
     return INT_MAX;
 }
 
-bool readGrid(const string &f, int &X, int &Y, vector<vector<int>> &g, int &s, int &e, vector<Coordinate> &p) {
-    ifstream in(f);
-    if (!in.is_open()) return false;
-    in >> X >> Y;
-    g.assign(Y, vector<int>(X));
-    auto id = [X](int x, int y) { return y * X + x; };
-    for (int y = 0; y < Y; ++y)
-        for (int x = 0; x < X; ++x) {
-            string t; in >> t;
-            if (t == "S") { g[y][x] = 1; s = id(x, y); }
-            else if (t == "G") { g[y][x] = 1; e = id(x, y); }
-            else if (t == "P") { g[y][x] = 1; p.push_back({x, y}); }
-            else g[y][x] = atoi(t.c_str());
-        }
+// Loads the hierarchy cached next to the map file, or builds it and writes
+// the cache for the next run.
+void prepareHierarchy(const string &f, const Grid &g) {
+    string err;
+    if (ch.load(f + ".ch", g, nullptr, getWeight, err)) return;
+    ch.build(g, nullptr, getWeight);
+    if (!ch.save(f + ".ch", err)) cerr << err << "\n";
+}
+
+bool readGrid(const string &f, Grid &g, int &s, int &e, vector<Coordinate> &p) {
+    vector<Tunnel> tunnels;
+    string err;
+    if (!loadGrid(f, g, s, e, p, tunnels, err)) { cerr << err << "\n"; return false; }
+    if (CONTRACTION_HIERARCHY) prepareHierarchy(f, g);
     return true;
 }
 
-vector<Coordinate> ucs(const vector<vector<int>> &g, int X, int Y, int s, int e, float &tc) {
-    int V = X * Y;
-    vector<int> from(V, -1);
-    vector<float> cost(V, INFINITY);
-    vector<char> vis(V, 0);
-    auto id = [X](int x, int y) { return y * X + x; };
-    auto nbs = [&](int n) {
-        int x = n % X, y = n / X; vector<int> r;
-        if (y > 0) r.push_back(id(x, y - 1));
-        if (x > 0) r.push_back(id(x - 1, y));
-        if (y + 1 < Y) r.push_back(id(x, y + 1));
-        if (x + 1 < X) r.push_back(id(x + 1, y));
-        return r;
-    };
-    priority_queue<Node, vector<Node>, greater<Node>> pq;
-    pq.push({s, 0}); cost[s] = 0;
-    while (!pq.empty()) {
-        Node cur = pq.top(); pq.pop();
-        if (vis[cur.id]) continue;
-        vis[cur.id] = 1; nodes_opened++;
-        if (cur.id == e) break;
-        for (int v : nbs(cur.id)) {
-            int vx = v % X, vy = v / X;
-            if (g[vy][vx] == 5) continue;
-            float w = getWeight(g[vy][vx]);
-            if (w == INT_MAX) continue;
-            float nc = cost[cur.id] + w;
-            if (nc < cost[v]) { cost[v] = nc; from[v] = cur.id; pq.push({v, nc}); }
-        }
+// Dijkstra on the shared search loop; OpenList is the heap or Dial's buckets.
+template <typename OpenList>
+vector<Coordinate> ucsWith(const Grid &g, int s, int e, float &tc, OpenList open) {
+    SearchResult r = bestFirstSearch(g, s, e, GridEdges{g}, [](int t) { return getWeight(t); }, ZeroHeuristic(), open);
+    nodes_opened += r.closed;
+    tc = r.cost < 0 ? INFINITY : float(r.cost);
+    vector<Coordinate> path;
+    for (int id : r.path) path.push_back(g.coord(id));
+    return path;
+}
+
+vector<Coordinate> ucs(const Grid &g, int s, int e, float &tc) { return ucsWith(g, s, e, tc, HeapOpenList()); }
+
+int maxWeight() {
+    int m = 1;
+    for (int t = 0; t <= 9; t++) if (getWeight(t) != INT_MAX) m = max(m, getWeight(t));
+    return m;
+}
+
+// Dial's algorithm: ucs() on integer costs with a bucket queue of maxWeight() + 1
+// buckets instead of a binary heap. Opens nodes in the same cost order.
+vector<Coordinate> ucsBuckets(const Grid &g, int s, int e, float &tc) {
+    return ucsWith(g, s, e, tc, BucketOpenList(maxWeight()));
+}
+
+// Order to collect every Pokemon, planned over the costs between S, G and
+// the Pokemon (one Dijkstra from each): Held-Karp's optimum when it fits,
+// else the tour optimizer's best within TOUR_TIME_BUDGET seconds. Returns
+// false, for the greedy order, when Held-Karp alone is on and there are too
+// many Pokemon.
+bool planTour(const Grid &g, int s, int e, const vector<Coordinate> &p, vector<int> &order) {
+    auto t0 = chrono::high_resolution_clock::now();
+    CostMatrix m;
+    auto points = pointsOfInterest(g, s, e, p, {});
+    auto weight = [](int t) { return getWeight(t); };
+    if (BUCKET_QUEUE) m.build(g, points, GridEdges{g}, weight, BucketOpenList(maxWeight()));
+    else m.build(g, points, GridEdges{g}, weight, HeapOpenList());
+    nodes_opened += m.closed();
+    matrix_time = chrono::duration<double>(chrono::high_resolution_clock::now() - t0).count();
+    auto dist = [&](int i, int j) { return m.at(i, j); };
+    string err;
+    if (HELD_KARP_TOUR && heldKarpOrder((int)p.size(), dist, order, err)) {
+        tour_stats.greedy = tourCost(nearestNeighborOrder((int)p.size(), dist), dist);
+        tour_stats.best = tourCost(order, dist);
+        return true;
+    }
+    if (!TOUR_OPTIMIZER) { cerr << err << "\n"; return false; }
+    order = optimizeTour((int)p.size(), dist, TOUR_TIME_BUDGET, tour_stats);
+    return true;
+}
+
+// Bidirectional Dijkstra. Entering a cell costs its terrain weight, so edges
+// are directed: u -> v costs getWeight(g[v]) whichever side relaxes it, and
+// the search from e charges the weight of the cell it comes from. A cell can
+// only be a predecessor if the forward search could leave it, which means s
+// or a cell with a finite weight. best is the cheapest s-e cost through a
+// cell labelled by both sides. The search stops once top_f + top_b >= best.
+vector<Coordinate> ucsBidirectional(const Grid &g, int s, int e, float &tc) {
+    using Item = pair<int, int>;
+    const int INF = INT_MAX / 2;
+    int V = g.size();
+    vector<int> dist[2] = {vector<int>(V, INF), vector<int>(V, INF)};
+    vector<int> link[2] = {vector<int>(V, -1), vector<int>(V, -1)};
+    vector<char> settled(V, 0);
+    priority_queue<Item, vector<Item>, greater<Item>> pq[2];
+    dist[0][s] = 0; pq[0].push({0, s});
+    dist[1][e] = 0; pq[1].push({0, e});
+    int best = s == e ? 0 : INF, meet = s == e ? s : -1;
+    while (!pq[0].empty() && !pq[1].empty()) {
+        if (pq[0].top().first + pq[1].top().first >= best) break;
+        int side = pq[0].top().first <= pq[1].top().first ? 0 : 1;
+        int u = pq[side].top().second; pq[side].pop();
+        if (settled[u] & (1 << side)) continue;
+        if (!settled[u]) nodes_opened++;
+        settled[u] |= 1 << side;
+        forEachNeighbor(g, u, [&](int v) {
+            int w = getWeight(g[side == 0 ? v : u]);
+            if (w == INT_MAX) return;
+            if (side == 1 && v != s && getWeight(g[v]) == INT_MAX) return;
+            int nd = dist[side][u] + w;
+            if (nd < dist[side][v]) {
+                dist[side][v] = nd; link[side][v] = u; pq[side].push({nd, v});
+                if (nd + dist[1 - side][v] < best) { best = nd + dist[1 - side][v]; meet = v; }
+            }
+        });
     }
-    tc = cost[e];
+    tc = best == INF ? INFINITY : float(best);
     vector<Coordinate> path;
-    if (from[e] != -1 || s == e) {
-        for (int cur = e; cur != -1; cur = from[cur])
-            path.push_back({cur % X, cur / X});
+    if (meet != -1) {
+        for (int cur = meet; cur != -1; cur = link[0][cur])
+            path.push_back(g.coord(cur));
         reverse(path.begin(), path.end());
+        for (int cur = link[1][meet]; cur != -1; cur = link[1][cur])
+            path.push_back(g.coord(cur));
     }
     return path;
 }
 
-inline int id2d(int X, int x, int y) { return y * X + x; }
+// Query on the contraction hierarchy of the map. Nodes opened counts the
+// cells settled by its two upward searches.
+vector<Coordinate> ucsContracted(const Grid &g, int s, int e, float &tc) {
+    vector<int> ids;
+    long long cost = ch.query(s, e, ids);
+    nodes_opened += ch.settled();
+    tc = cost < 0 ? INFINITY : float(cost);
+    vector<Coordinate> path;
+    for (int id : ids) path.push_back(g.coord(id));
+    return path;
+}
 
 void printMemoryUsage() {
     PROCESS_MEMORY_COUNTERS_EX pmc;
@@ -94,31 +184,38 @@ void printMemoryUsage() {
     cout << "Memory usage: " << memUsed / (1024.0 * 1024.0) << " MB\n";
 }
 
-int main() {
+int main(int argc, char **argv) {
     auto start = chrono::high_resolution_clock::now();
 
-    int X, Y, s = -1, e = -1;
-    vector<vector<int>> g;
+    int s = -1, e = -1;
+    Grid g;
     vector<Coordinate> p;
-    if (!readGrid(GRID_FILE, X, Y, g, s, e, p)) return 1;
-    int V = X * Y;
-    if (s == -1) s = 0;
-    if (e == -1) e = V - 1;
+    if (!readGrid(argc > 1 ? argv[1] : GRID_FILE, g, s, e, p)) return 1;
+    if (s == -1) s = g.id(0, 0);
+    if (e == -1) e = g.id(g.X - 1, g.Y - 1);
+    auto search = CONTRACTION_HIERARCHY ? ucsContracted : BIDIRECTIONAL_UCS ? ucsBidirectional : BUCKET_QUEUE ? ucsBuckets : ucs;
     vector<int> got(p.size(), 0);
-    Coordinate cur = {s % X, s / X};
+    Coordinate cur = g.coord(s);
     vector<Coordinate> total;
     float total_cost = 0;
     total.push_back(cur);
+    vector<int> order;
+    bool tour = (HELD_KARP_TOUR || TOUR_OPTIMIZER) && planTour(g, s, e, p, order);
 
 for (int i = 0; i < (int)p.size(); i++) {
     int nearest_idx = -1;
     float ncost = INFINITY;
     vector<Coordinate> seg;
 
-    for (int j = 0; j < (int)p.size(); j++) {
+    if (tour) {
+        if (i == (int)order.size()) break;
+        nearest_idx = order[i];
+        seg = search(g, g.id(cur.x, cur.y), g.id(p[nearest_idx].x, p[nearest_idx].y), ncost);
+    }
+    else for (int j = 0; j < (int)p.size(); j++) {
         if (got[j]) continue;
         float sc = 0;
-        auto path = ucs(g, X, Y, id2d(X, cur.x, cur.y), id2d(X, p[j].x, p[j].y), sc);
+        auto path = search(g, g.id(cur.x, cur.y), g.id(p[j].x, p[j].y), sc);
         if (!path.empty() && sc < ncost) { 
             ncost = sc; 
             nearest_idx = j; 
@@ -134,7 +231,7 @@ for (int i = 0; i < (int)p.size(); i++) {
 }
 
     float sc = 0;
-    auto last = ucs(g, X, Y, id2d(X, cur.x, cur.y), e, sc);
+    auto last = search(g, g.id(cur.x, cur.y), e, sc);
     if (!last.empty()) { total.insert(total.end(), last.begin() + 1, last.end()); total_cost += sc; }
 
     cout << "Shortest path visiting all Pokemons (UCS):\n";
@@ -142,6 +239,10 @@ for (int i = 0; i < (int)p.size(); i++) {
     cout << "\nTotal steps: " << total.size() - 1;
     cout << "\nTotal nodes opened: " << nodes_opened;
     cout << "\nTotal weight: " << total_cost << "\n";
+    if (tour) {
+        cout << "Distance matrix time: " << matrix_time << " seconds\n";
+        cout << "Planned tour weight: " << tour_stats.best << " (greedy " << tour_stats.greedy << ", " << tour_stats.restarts << " restarts)\n";
+    }
 
     auto end = chrono::high_resolution_clock::now();
     chrono::duration<double> duration = end - start;
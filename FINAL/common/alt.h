@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "bucket_queue.h"
+#include "fingerprint.h"
+#include "grid.h"
+#include "portals.h"
+
+// Landmark file (little endian):
+//   AltHeader
+//   int32 landmark[count]
+//   uint32 dist[cells * count]   dist[v * count + i] is the cost from landmark
+//                                i to cell v, UINT32_MAX when unreachable
+// cells is the padded Grid::size(); fingerprint is mapFingerprint() of the
+// map and cost table the file was built for. count is 1 .. ALT_MAX_LANDMARKS.
+constexpr char ALT_MAGIC[8] = {'K', 'K', 'A', 'A', 'L', 'T', '\0', '\0'};
+constexpr uint32_t ALT_VERSION = 1;
+constexpr uint32_t ALT_MAX_LANDMARKS = 256;
+
+struct AltHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width, height;
+    uint64_t fingerprint;
+    uint64_t cells;
+    uint32_t count, reserved;
+};
+
+// ALT heuristic: exact costs from a few landmarks to every cell give, by the
+// triangle inequality, a lower bound on the cost between any two cells, so
+// one precomputation serves every goal. A step costs the weight of the cell
+// it enters and tunnels work both ways, so the cost back to a landmark is
+// d(v -> L) = d(L -> v) + c(L) - c(v) and one table per landmark covers both
+// directions. Landmarks are picked farthest first: each new one is the
+// reachable cell whose nearest landmark is farthest away.
+class Landmarks
+{
+public:
+    // cost(t) is the cost of entering a cell of terrain t; values of INT_MAX
+    // or more mark impassable terrain, and terrain 5 always is.
+    template <typename Cost>
+    void build(const Grid &grid, const PortalIndex *portals, int count, Cost cost)
+    {
+        setCosts(grid, portals, cost);
+        const int V = grid.size();
+        landmarks_.clear();
+        count_ = 0;
+        dist_.assign(static_cast<size_t>(V) * count, UINT32_MAX);
+        int seed = -1;
+        for (int v = 0; v < V && seed == -1; ++v)
+            if (cost_[grid[v]] >= 0)
+                seed = v;
+        if (seed == -1)
+        {
+            dist_.clear();
+            return;
+        }
+        std::vector<uint32_t> d, nearest(V, UINT32_MAX);
+        sweep(seed, d);
+        int next = farthest(d);
+        for (int i = 0; i < count; ++i)
+        {
+            landmarks_.push_back(next);
+            sweep(next, d);
+            for (int v = 0; v < V; ++v)
+            {
+                dist_[static_cast<size_t>(v) * count + i] = d[v];
+                nearest[v] = std::min(nearest[v], d[v]);
+            }
+            next = farthest(nearest);
+        }
+        count_ = count;
+    }
+
+    // Reads tables written by save(); fails when the file is missing or was
+    // built for another map, tunnel set or cost table.
+    template <typename Cost>
+    bool load(const std::string &filename, const Grid &grid, const PortalIndex *portals, Cost cost,
+              std::string &error)
+    {
+        setCosts(grid, portals, cost);
+        FILE *f = fopen(filename.c_str(), "rb");
+        AltHeader h;
+        if (f == nullptr || fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, ALT_MAGIC, sizeof(ALT_MAGIC)) != 0 ||
+            h.version != ALT_VERSION || h.header_size != sizeof(AltHeader))
+        {
+            error = filename + ": not a landmark file";
+            if (f != nullptr)
+                fclose(f);
+            return false;
+        }
+        if (h.width != grid.X || h.height != grid.Y || h.fingerprint != fingerprint_ ||
+            h.cells != static_cast<uint64_t>(grid.size()))
+        {
+            error = filename + ": built for a different map";
+            fclose(f);
+            return false;
+        }
+        // Sizes come from the file, so check them against it before allocating.
+        std::error_code ec;
+        uint64_t bytes = std::filesystem::file_size(filename, ec);
+        if (ec || h.count == 0 || h.count > ALT_MAX_LANDMARKS ||
+            bytes != sizeof(AltHeader) + 4ull * h.count + 4ull * h.cells * h.count)
+        {
+            error = filename + ": corrupt landmark file";
+            fclose(f);
+            return false;
+        }
+        landmarks_.resize(h.count);
+        dist_.resize(h.cells * h.count);
+        bool ok = fread(landmarks_.data(), sizeof(int), landmarks_.size(), f) == landmarks_.size() &&
+                  fread(dist_.data(), sizeof(uint32_t), dist_.size(), f) == dist_.size();
+        fclose(f);
+        for (int l : landmarks_)
+            ok = ok && l >= 0 && l < grid.size();
+        if (!ok)
+        {
+            error = filename + ": truncated or corrupt landmark file";
+            landmarks_.clear();
+            dist_.clear();
+            return false;
+        }
+        count_ = static_cast<int>(h.count);
+        return true;
+    }
+
+    bool save(const std::string &filename, std::string &error) const
+    {
+        AltHeader h{};
+        memcpy(h.magic, ALT_MAGIC, sizeof(h.magic));
+        h.version = ALT_VERSION;
+        h.header_size = sizeof(AltHeader);
+        h.width = grid_->X;
+        h.height = grid_->Y;
+        h.fingerprint = fingerprint_;
+        h.cells = grid_->size();
+        h.count = count_;
+        // Written under a temporary name and renamed, so a crash part way
+        // never leaves a torn file under the real name.
+        std::string temp = filename + "." + std::to_string(std::random_device{}()) + ".tmp";
+        FILE *f = fopen(temp.c_str(), "wb");
+        bool ok = f != nullptr && fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(landmarks_.data(), sizeof(int), landmarks_.size(), f) == landmarks_.size() &&
+                  fwrite(dist_.data(), sizeof(uint32_t), dist_.size(), f) == dist_.size();
+        if (f != nullptr && fclose(f) != 0)
+            ok = false;
+        std::error_code ec;
+        if (ok)
+        {
+            std::filesystem::rename(temp, filename, ec);
+            ok = !ec;
+        }
+        if (!ok)
+        {
+            std::filesystem::remove(temp, ec);
+            error = filename + ": cannot write landmark file";
+        }
+        return ok;
+    }
+
+    int count() const { return count_; }
+    int landmark(int i) const { return landmarks_[i]; }
+
+    // Lower bound on the cost of a path from v to goal. With dv, dg the costs
+    // from landmark L: d(v, goal) >= dg - dv, and d(v, goal) >= d(v, L) -
+    // d(goal, L) = dv - dg + c(goal) - c(v).
+    long long bound(int v, int goal) const
+    {
+        if (count_ == 0)
+            return 0;
+        const uint32_t *a = &dist_[static_cast<size_t>(v) * count_];
+        const uint32_t *b = &dist_[static_cast<size_t>(goal) * count_];
+        const long long back = cost_[(*grid_)[goal]] - cost_[(*grid_)[v]];
+        long long best = 0;
+        for (int i = 0; i < count_; ++i)
+        {
+            if (a[i] == UINT32_MAX || b[i] == UINT32_MAX)
+                continue;
+            long long dv = a[i], dg = b[i];
+            best = std::max(best, std::max(dg - dv, dv - dg + back));
+        }
+        return best;
+    }
+
+private:
+    template <typename Cost>
+    void setCosts(const Grid &grid, const PortalIndex *portals, Cost cost)
+    {
+        grid_ = &grid;
+        portals_ = portals != nullptr && !portals->empty() ? portals : nullptr;
+        costTable(cost, cost_);
+        max_cost_ = std::max(1, *std::max_element(cost_, cost_ + TERRAINS));
+        fingerprint_ = mapFingerprint(grid, portals_, cost_);
+    }
+
+    // Dijkstra from source over passable cells; d[v] = UINT32_MAX if unreached.
+    void sweep(int source, std::vector<uint32_t> &d) const
+    {
+        const Grid &grid = *grid_;
+        d.assign(grid.size(), UINT32_MAX);
+        BucketQueue queue(max_cost_);
+        d[source] = 0;
+        queue.push(source, 0);
+        while (!queue.empty())
+        {
+            long long du;
+            int u = queue.pop(du);
+            if (du != d[u])
+                continue;
+            auto relax = [&](int v)
+            {
+                int c = cost_[grid[v]];
+                if (c < 0 || du + c >= d[v])
+                    return;
+                d[v] = static_cast<uint32_t>(du + c);
+                queue.push(v, d[v]);
+            };
+            if (portals_ != nullptr)
+                forEachNeighbor(grid, *portals_, u, relax);
+            else
+                forEachNeighbor(grid, u, relax);
+        }
+    }
+
+    // Reached cell with the largest d, ties to the lowest id.
+    static int farthest(const std::vector<uint32_t> &d)
+    {
+        int best = -1;
+        for (int v = 0; v < static_cast<int>(d.size()); ++v)
+            if (d[v] != UINT32_MAX && (best == -1 || d[v] > d[best]))
+                best = v;
+        return best;
+    }
+
+    const Grid *grid_ = nullptr;
+    const PortalIndex *portals_ = nullptr;
+    int cost_[TERRAINS] = {};
+    int max_cost_ = 1;
+    uint64_t fingerprint_ = 0;
+    int count_ = 0;
+    std::vector<int> landmarks_;
+    std::vector<uint32_t> dist_;
+};
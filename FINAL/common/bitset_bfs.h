@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "grid.h"
+#include "portals.h"
+
+// Unweighted BFS that moves a whole level at once on packed bit rows. Row y
+// holds cells x = 64 * w + b as bit b of word w. A level step is
+//   next = (f << 1 | f >> 1 | f above | f below) & passable & ~visited
+// evaluated only on the words next to a non-empty frontier word, so the work
+// per level follows the frontier rather than the grid. Tunnels are a sparse
+// correction after each step: the active frontier words are masked with the
+// mouths in the same layout, and each mouth found sets its exits in next. path() records the level of each reached cell and then walks back
+// from the goal through neighbours one level lower.
+class BitsetBfs
+{
+public:
+    // grid (and portals, when given) must outlive the searches.
+    void build(const Grid &grid, const PortalIndex *portals = nullptr)
+    {
+        grid_ = &grid;
+        portals_ = portals;
+        W_ = (grid.X + 63) / 64;
+        passable_.assign(static_cast<size_t>(W_) * grid.Y, 0);
+        for (int y = 0; y < grid.Y; ++y)
+            for (int x = 0; x < grid.X; ++x)
+                if (grid[grid.id(x, y)] != 5)
+                    passable_[word(x, y)] |= bit(x);
+        mouth_.clear();
+        if (portals != nullptr && !portals->empty())
+        {
+            mouth_.assign(passable_.size(), 0);
+            for (int y = 0; y < grid.Y; ++y)
+                for (int x = 0; x < grid.X; ++x)
+                    if (portals->isMouth(grid.id(x, y)))
+                        mouth_[word(x, y)] |= bit(x);
+        }
+    }
+
+    // Steps from start_id to goal_id, or -1 when the goal cannot be reached.
+    int distance(int start_id, int goal_id) { return run(start_id, goal_id, nullptr); }
+
+    // Shortest path as cell ids from start_id to goal_id; empty when unreachable.
+    std::vector<int> path(int start_id, int goal_id)
+    {
+        const Grid &g = *grid_;
+        std::vector<int> level(g.size(), -1);
+        std::vector<int> ids;
+        if (run(start_id, goal_id, &level) < 0)
+            return ids;
+        for (int cur = goal_id;;)
+        {
+            ids.push_back(cur);
+            if (level[cur] == 0)
+                break;
+            int prev = -1;
+            auto back = [&](int v)
+            {
+                if (prev == -1 && level[v] == level[cur] - 1)
+                    prev = v;
+            };
+            if (portals_ != nullptr)
+                forEachNeighbor(g, *portals_, cur, back);
+            else
+                forEachNeighbor(g, cur, back);
+            cur = prev;
+        }
+        return std::vector<int>(ids.rbegin(), ids.rend());
+    }
+
+    // Cells reached by the last search, start included.
+    long long reached() const { return reached_; }
+
+private:
+    size_t word(int x, int y) const { return static_cast<size_t>(y) * W_ + (x >> 6); }
+    static uint64_t bit(int x) { return uint64_t(1) << (x & 63); }
+
+    int run(int start_id, int goal_id, std::vector<int> *level)
+    {
+        const Grid &g = *grid_;
+        const size_t words = static_cast<size_t>(W_) * g.Y;
+        frontier_.assign(words, 0);
+        next_.assign(words, 0);
+        visited_.assign(words, 0);
+        stamp_.assign(words, 0);
+        active_.clear();
+
+        int sx = g.xOf(start_id), sy = g.yOf(start_id);
+        size_t goal_word = word(g.xOf(goal_id), g.yOf(goal_id));
+        uint64_t goal_bit = bit(g.xOf(goal_id));
+        frontier_[word(sx, sy)] = visited_[word(sx, sy)] = bit(sx);
+        active_.push_back(word(sx, sy));
+        reached_ = 1;
+        if (level != nullptr)
+            (*level)[start_id] = 0;
+        if (start_id == goal_id)
+            return 0;
+
+        for (int d = 1; !active_.empty(); ++d)
+        {
+            candidates_.clear();
+            for (size_t i : active_)
+            {
+                size_t w = i % W_;
+                mark(i, d);
+                if (w > 0)
+                    mark(i - 1, d);
+                if (w + 1 < static_cast<size_t>(W_))
+                    mark(i + 1, d);
+                if (i >= static_cast<size_t>(W_))
+                    mark(i - W_, d);
+                if (i + W_ < words)
+                    mark(i + W_, d);
+            }
+            next_active_.clear();
+            for (size_t i : candidates_)
+            {
+                size_t w = i % W_;
+                uint64_t c = frontier_[i];
+                uint64_t m = (c << 1) | (c >> 1);
+                if (w > 0)
+                    m |= frontier_[i - 1] >> 63;
+                if (w + 1 < static_cast<size_t>(W_))
+                    m |= frontier_[i + 1] << 63;
+                if (i >= static_cast<size_t>(W_))
+                    m |= frontier_[i - W_];
+                if (i + W_ < words)
+                    m |= frontier_[i + W_];
+                m &= passable_[i] & ~visited_[i];
+                if (m != 0)
+                {
+                    next_[i] = m;
+                    next_active_.push_back(i);
+                }
+            }
+            for (size_t k = 0; !mouth_.empty() && k < active_.size(); ++k)
+            {
+                size_t a = active_[k];
+                for (uint64_t bits = frontier_[a] & mouth_[a]; bits != 0; bits &= bits - 1)
+                {
+                    int mouth = g.id(static_cast<int>(a % W_) * 64 + ctz64(bits), static_cast<int>(a / W_));
+                    portals_->forEachExit(mouth, [&](int v)
+                    {
+                        size_t i = word(g.xOf(v), g.yOf(v));
+                        uint64_t b = bit(g.xOf(v));
+                        if (!(passable_[i] & b) || (visited_[i] & b))
+                            return;
+                        if (next_[i] == 0)
+                            next_active_.push_back(i);
+                        next_[i] |= b;
+                    });
+                }
+            }
+            for (size_t i : next_active_)
+            {
+                visited_[i] |= next_[i];
+                reached_ += popcount64(next_[i]);
+                if (level != nullptr)
+                    for (uint64_t bits = next_[i]; bits != 0; bits &= bits - 1)
+                        (*level)[g.id(static_cast<int>(i % W_) * 64 + ctz64(bits), static_cast<int>(i / W_))] = d;
+            }
+            for (size_t i : active_)
+                frontier_[i] = 0;
+            frontier_.swap(next_);
+            active_.swap(next_active_);
+            if (frontier_[goal_word] & goal_bit)
+                return d;
+        }
+        return -1;
+    }
+
+    void mark(size_t i, int d)
+    {
+        if (stamp_[i] != d)
+        {
+            stamp_[i] = d;
+            candidates_.push_back(i);
+        }
+    }
+
+    const Grid *grid_ = nullptr;
+    const PortalIndex *portals_ = nullptr;
+    int W_ = 0;
+    std::vector<uint64_t> passable_, mouth_, frontier_, next_, visited_;
+    std::vector<int> stamp_;
+    std::vector<size_t> active_, next_active_, candidates_;
+    long long reached_ = 0;
+};
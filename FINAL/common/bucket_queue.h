@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// Dial's bucket queue: a monotone priority queue for integer keys where every
+// pushed key lies between the last popped key and that key plus max_step. The
+// keys then fit max_step + 1 circular buckets, so push and pop are O(1) apart
+// from skipping empty buckets, at most max_step of them per pop. Entries
+// with the same key come out last in, first out.
+class BucketQueue
+{
+public:
+    explicit BucketQueue(int max_step) : buckets_(max_step + 1) {}
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    void clear()
+    {
+        for (auto &b : buckets_)
+            b.clear();
+        current_ = 0;
+        size_ = 0;
+    }
+
+    void push(int id, long long key)
+    {
+        buckets_[key % buckets_.size()].push_back(id);
+        ++size_;
+    }
+
+    // Removes an entry with the smallest key and stores that key in key.
+    int pop(long long &key)
+    {
+        std::vector<int> *b = &buckets_[current_ % buckets_.size()];
+        while (b->empty())
+            b = &buckets_[++current_ % buckets_.size()];
+        int id = b->back();
+        b->pop_back();
+        --size_;
+        key = current_;
+        return id;
+    }
+
+private:
+    std::vector<std::vector<int>> buckets_;
+    long long current_ = 0;
+    size_t size_ = 0;
+};
+
+// Two-level bucket open list for A*. Entries come out by smallest f, then
+// largest g, then last in, first out. f and g are non-negative integers. f may
+// drop below the last popped value (inconsistent heuristics, reopened nodes);
+// the scan cursor then just moves back. Each f bucket keeps a g-sorted run
+// that pops from the back. A push that does not go below the run's largest g
+// (the usual case while a bucket is being expanded) is appended to it; other
+// pushes wait unsorted and are merged in once, when the bucket is next popped.
+class FgBucketQueue
+{
+public:
+    struct Entry
+    {
+        long long f, g;
+        int id;
+    };
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    void push(long long f, long long g, int id)
+    {
+        if (f >= static_cast<long long>(buckets_.size()))
+            buckets_.resize(static_cast<size_t>(f) + 1);
+        Bucket &b = buckets_[f];
+        if (b.pending.empty() && (b.sorted.empty() || b.sorted.back().g <= g))
+            b.sorted.push_back({g, id});
+        else
+            b.pending.push_back({g, id});
+        if (f < min_f_ || size_ == 0)
+            min_f_ = f;
+        ++size_;
+    }
+
+    Entry pop()
+    {
+        while (buckets_[min_f_].sorted.empty() && buckets_[min_f_].pending.empty())
+            ++min_f_;
+        Bucket &b = buckets_[min_f_];
+        if (!b.pending.empty())
+        {
+            auto byG = [](const Item &a, const Item &c) { return a.g < c.g; };
+            std::stable_sort(b.pending.begin(), b.pending.end(), byG);
+            size_t mid = b.sorted.size();
+            b.sorted.insert(b.sorted.end(), b.pending.begin(), b.pending.end());
+            std::inplace_merge(b.sorted.begin(), b.sorted.begin() + mid, b.sorted.end(), byG);
+            b.pending.clear();
+        }
+        Item it = b.sorted.back();
+        b.sorted.pop_back();
+        --size_;
+        return {min_f_, it.g, it.id};
+    }
+
+private:
+    struct Item
+    {
+        long long g;
+        int id;
+    };
+    struct Bucket
+    {
+        std::vector<Item> sorted, pending;
+    };
+    std::vector<Bucket> buckets_;
+    long long min_f_ = 0;
+    size_t size_ = 0;
+};
@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "fingerprint.h"
+#include "grid.h"
+#include "portals.h"
+
+// Contraction hierarchy file (little endian):
+//   ChHeader
+//   int32 rank[cells]
+//   int32 first[cells + 1]   upward arcs of cell u are first[u] .. first[u + 1] - 1
+//   int32 to[arcs], cost[arcs], mid[arcs]
+// cells is the padded Grid::size(). fingerprint covers the terrain, the
+// tunnels and the weight table, so a file built for another map or other
+// weights is refused.
+constexpr char CH_MAGIC[8] = {'K', 'K', 'A', 'C', 'H', '\0', '\0', '\0'};
+constexpr uint32_t CH_VERSION = 1;
+
+struct ChHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width, height;
+    uint64_t fingerprint;
+    uint64_t cells, arcs;
+};
+
+// Contraction hierarchy over the grid graph for repeated point-to-point
+// queries on one map. A step costs the weight of the cell it enters. Every
+// move can be walked back, so the graph is stored undirected with arc cost
+// weight(u) + weight(v): a path from s to t then costs twice its real cost
+// plus weight(s) - weight(t), the same for every path between s and t, and
+// shortest paths are unchanged.
+//
+// build() contracts the cells in lazy edge-difference order. Each contracted
+// cell gets shortcuts between its remaining neighbours unless a bounded
+// witness search finds a path that is no longer. Only arcs that lead to a
+// later contracted cell are kept. A query runs Dijkstra upwards from both
+// ends and unpacks the shortcuts of the best meeting.
+class ContractionHierarchy
+{
+public:
+    // weight(t) is the cost of entering a cell of terrain t. Values of
+    // INT_MAX or more mark impassable terrain; terrain 5 is always impassable.
+    template <typename Weight>
+    void build(const Grid &grid, const PortalIndex *portals, Weight weight)
+    {
+        setWeights(grid, portals, weight);
+        const int V = grid.size();
+        std::vector<std::vector<Arc>> adj(V);
+        for (int u = 0; u < V; ++u)
+        {
+            if (cost_[grid[u]] < 0)
+                continue;
+            auto add = [&](int v)
+            {
+                if (v != u && cost_[grid[v]] >= 0)
+                    link(adj, u, v, cost_[grid[u]] + cost_[grid[v]], -1);
+            };
+            if (portals != nullptr)
+                forEachNeighbor(grid, *portals, u, add);
+            else
+                forEachNeighbor(grid, u, add);
+        }
+
+        rank_.assign(V, -1);
+        std::vector<int> deleted(V, 0);
+        std::vector<int> wdist(V, INT_MAX), wstamp(V, 0), wgoal(V, 0);
+        int wround = 0;
+        // Shortcuts that contracting v would add, added for real when apply
+        // is set. Neighbour pairs are handled once each, from the lower index.
+        auto contract = [&](int v, bool apply)
+        {
+            std::vector<Arc> nb;
+            for (const Arc &a : adj[v])
+                if (rank_[a.to] < 0)
+                    nb.push_back(a);
+            int added = 0;
+            for (size_t i = 0; i + 1 < nb.size(); ++i)
+            {
+                int limit = 0;
+                ++wround;
+                for (size_t j = i + 1; j < nb.size(); ++j)
+                {
+                    limit = std::max(limit, nb[i].cost + nb[j].cost);
+                    wgoal[nb[j].to] = wround;
+                }
+                witness(adj, nb[i].to, v, limit, static_cast<int>(nb.size() - i - 1), wgoal, wdist, wstamp, wround);
+                for (size_t j = i + 1; j < nb.size(); ++j)
+                {
+                    int need = nb[i].cost + nb[j].cost;
+                    int w = nb[j].to;
+                    if (wstamp[w] == wround && wdist[w] <= need)
+                        continue;
+                    added++;
+                    if (apply)
+                        link(adj, nb[i].to, w, need, v);
+                }
+            }
+            return static_cast<int>(nb.size()) - added;
+        };
+        auto priority = [&](int v)
+        { return deleted[v] - contract(v, false); };
+
+        using Entry = std::pair<int, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> order;
+        for (int v = 0; v < V; ++v)
+            if (cost_[grid[v]] >= 0)
+                order.push({priority(v), v});
+        int next = 0;
+        while (!order.empty())
+        {
+            int v = order.top().second;
+            order.pop();
+            if (rank_[v] >= 0)
+                continue;
+            int p = priority(v);
+            if (!order.empty() && p > order.top().first)
+            {
+                order.push({p, v});
+                continue;
+            }
+            contract(v, true);
+            rank_[v] = next++;
+            for (const Arc &a : adj[v])
+                deleted[a.to]++;
+        }
+
+        first_.assign(V + 1, 0);
+        for (int u = 0; u < V; ++u)
+            for (const Arc &a : adj[u])
+                if (rank_[a.to] > rank_[u])
+                    first_[u + 1]++;
+        for (int u = 0; u < V; ++u)
+            first_[u + 1] += first_[u];
+        to_.resize(first_[V]);
+        arc_cost_.resize(first_[V]);
+        mid_.resize(first_[V]);
+        for (int u = 0; u < V; ++u)
+        {
+            int k = first_[u];
+            for (const Arc &a : adj[u])
+                if (rank_[a.to] > rank_[u])
+                {
+                    to_[k] = a.to;
+                    arc_cost_[k] = a.cost;
+                    mid_[k] = a.mid;
+                    ++k;
+                }
+            std::vector<Arc>().swap(adj[u]);
+        }
+        prepareQuery();
+    }
+
+    // Reads a hierarchy written by save(). Fails when the file is missing or
+    // was built for another map, tunnel set or weight table.
+    template <typename Weight>
+    bool load(const std::string &filename, const Grid &grid, const PortalIndex *portals, Weight weight,
+              std::string &error)
+    {
+        setWeights(grid, portals, weight);
+        FILE *f = fopen(filename.c_str(), "rb");
+        ChHeader h;
+        if (f == nullptr || fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, CH_MAGIC, sizeof(CH_MAGIC)) != 0 ||
+            h.version != CH_VERSION || h.header_size != sizeof(ChHeader))
+        {
+            error = filename + ": not a contraction hierarchy file";
+            if (f != nullptr)
+                fclose(f);
+            return false;
+        }
+        if (h.width != grid.X || h.height != grid.Y || h.fingerprint != fingerprint_ ||
+            h.cells != static_cast<uint64_t>(grid.size()))
+        {
+            error = filename + ": built for a different map";
+            fclose(f);
+            return false;
+        }
+        // Sizes come from the file, so check them against it before allocating.
+        std::error_code ec;
+        uint64_t bytes = std::filesystem::file_size(filename, ec);
+        if (ec || h.arcs > INT32_MAX || bytes != sizeof(ChHeader) + 4 * (2 * h.cells + 1 + 3 * h.arcs))
+        {
+            error = filename + ": corrupt contraction hierarchy";
+            fclose(f);
+            return false;
+        }
+        rank_.resize(h.cells);
+        first_.resize(h.cells + 1);
+        to_.resize(h.arcs);
+        arc_cost_.resize(h.arcs);
+        mid_.resize(h.arcs);
+        bool ok = readInts(f, rank_) && readInts(f, first_) && readInts(f, to_) && readInts(f, arc_cost_) &&
+                  readInts(f, mid_);
+        fclose(f);
+        if (!ok)
+        {
+            error = filename + ": truncated contraction hierarchy";
+            return false;
+        }
+        if (!validArcs())
+        {
+            error = filename + ": corrupt contraction hierarchy";
+            return false;
+        }
+        prepareQuery();
+        return true;
+    }
+
+    bool save(const std::string &filename, std::string &error) const
+    {
+        ChHeader h{};
+        memcpy(h.magic, CH_MAGIC, sizeof(h.magic));
+        h.version = CH_VERSION;
+        h.header_size = sizeof(ChHeader);
+        h.width = grid_->X;
+        h.height = grid_->Y;
+        h.fingerprint = fingerprint_;
+        h.cells = rank_.size();
+        h.arcs = to_.size();
+        FILE *f = fopen(filename.c_str(), "wb");
+        bool ok = f != nullptr && fwrite(&h, sizeof(h), 1, f) == 1 && writeInts(f, rank_) && writeInts(f, first_) &&
+                  writeInts(f, to_) && writeInts(f, arc_cost_) && writeInts(f, mid_);
+        if (f != nullptr && fclose(f) != 0)
+            ok = false;
+        if (!ok)
+            error = filename + ": cannot write contraction hierarchy";
+        return ok;
+    }
+
+    size_t arcs() const { return to_.size(); }
+
+    // Cost of the cheapest path from s to t (the sum of the weights of the
+    // cells entered), or -1 when there is none; path gets its cells. Like
+    // ucs(), an impassable s can be left but not entered, and an impassable t
+    // is never reached.
+    long long query(int s, int t, std::vector<int> &path)
+    {
+        path.clear();
+        settled_ = 0;
+        if (s == t)
+        {
+            path.push_back(s);
+            return 0;
+        }
+        if (cost_[(*grid_)[t]] < 0)
+            return -1;
+        using Entry = std::pair<int, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq[2];
+        ++round_;
+        auto seed = [&](int side, int v, int d)
+        {
+            if (stamp_[side][v] == round_ && dist_[side][v] <= d)
+                return;
+            stamp_[side][v] = round_;
+            dist_[side][v] = d;
+            parent_[side][v] = -1;
+            pq[side].push({d, v});
+        };
+        // An impassable s has no arcs but may still be left, as in the plain
+        // searches: weigh it 0 and start from its passable neighbours, each
+        // at the doubled distance weight(v) + 0.
+        const int ws = cost_[(*grid_)[s]];
+        if (ws >= 0)
+            seed(0, s, 0);
+        else
+        {
+            auto leave = [&](int v)
+            {
+                if (cost_[(*grid_)[v]] >= 0)
+                    seed(0, v, cost_[(*grid_)[v]]);
+            };
+            if (portals_ != nullptr)
+                forEachNeighbor(*grid_, *portals_, s, leave);
+            else
+                forEachNeighbor(*grid_, s, leave);
+        }
+        seed(1, t, 0);
+        long long best = LLONG_MAX;
+        int meet = -1;
+        while (!pq[0].empty() || !pq[1].empty())
+        {
+            int side = pq[1].empty() || (!pq[0].empty() && pq[0].top().first <= pq[1].top().first) ? 0 : 1;
+            int d = pq[side].top().first, u = pq[side].top().second;
+            pq[side].pop();
+            if (d != dist_[side][u])
+                continue;
+            if (d >= best)
+            {
+                pq[side] = {};
+                continue;
+            }
+            settled_++;
+            if (stamp_[1 - side][u] == round_ && d + static_cast<long long>(dist_[1 - side][u]) < best)
+            {
+                best = d + static_cast<long long>(dist_[1 - side][u]);
+                meet = u;
+            }
+            for (int k = first_[u]; k < first_[u + 1]; ++k)
+            {
+                int v = to_[k], nd = d + arc_cost_[k];
+                if (stamp_[side][v] != round_ || nd < dist_[side][v])
+                {
+                    stamp_[side][v] = round_;
+                    dist_[side][v] = nd;
+                    parent_[side][v] = u;
+                    pq[side].push({nd, v});
+                }
+            }
+        }
+        if (meet == -1)
+            return -1;
+        std::vector<int> chain;
+        for (int v = meet; v != -1; v = parent_[0][v])
+            chain.push_back(v);
+        std::reverse(chain.begin(), chain.end());
+        for (int v = parent_[1][meet]; v != -1; v = parent_[1][v])
+            chain.push_back(v);
+        path.push_back(s);
+        if (chain[0] != s)
+            path.push_back(chain[0]);
+        for (size_t i = 1; i < chain.size(); ++i)
+            unpack(chain[i - 1], chain[i], path);
+        return (best + cost_[(*grid_)[t]] - std::max(ws, 0)) / 2;
+    }
+
+    // Cells settled by the last query, both directions together.
+    long long settled() const { return settled_; }
+
+private:
+    struct Arc
+    {
+        int to, cost, mid;
+    };
+
+    template <typename Weight>
+    void setWeights(const Grid &grid, const PortalIndex *portals, Weight weight)
+    {
+        grid_ = &grid;
+        portals_ = portals;
+        costTable(weight, cost_);
+        fingerprint_ = mapFingerprint(grid, portals, cost_);
+    }
+
+    static void link(std::vector<std::vector<Arc>> &adj, int u, int v, int cost, int mid)
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            bool found = false;
+            for (Arc &a : adj[u])
+                if (a.to == v)
+                {
+                    if (cost < a.cost)
+                        a = {v, cost, mid};
+                    found = true;
+                    break;
+                }
+            if (!found)
+                adj[u].push_back({v, cost, mid});
+            std::swap(u, v);
+        }
+    }
+
+    // Dijkstra from u among cells not yet contracted, skipping via, until the
+    // cells marked in goal are settled, the cost passes limit or a fixed
+    // number of cells is settled.
+    void witness(const std::vector<std::vector<Arc>> &adj, int u, int via, int limit, int targets,
+                 const std::vector<int> &goal, std::vector<int> &dist, std::vector<int> &stamp, int round) const
+    {
+        using Entry = std::pair<int, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pq;
+        stamp[u] = round;
+        dist[u] = 0;
+        pq.push({0, u});
+        for (int settled = 0; !pq.empty() && settled < 64;)
+        {
+            int d = pq.top().first, x = pq.top().second;
+            pq.pop();
+            if (d != dist[x])
+                continue;
+            if (d > limit)
+                break;
+            if (goal[x] == round && --targets == 0)
+                break;
+            settled++;
+            for (const Arc &a : adj[x])
+            {
+                if (a.to == via || rank_[a.to] >= 0)
+                    continue;
+                int nd = d + a.cost;
+                if (stamp[a.to] != round || nd < dist[a.to])
+                {
+                    stamp[a.to] = round;
+                    dist[a.to] = nd;
+                    pq.push({nd, a.to});
+                }
+            }
+        }
+    }
+
+    // Appends the cells after a up to b, replacing shortcuts by the two arcs
+    // they stand for. The arc between two cells lives with the lower ranked one.
+    void unpack(int a, int b, std::vector<int> &path) const
+    {
+        std::vector<std::pair<int, int>> todo = {{a, b}};
+        while (!todo.empty())
+        {
+            auto [x, y] = todo.back();
+            todo.pop_back();
+            int lo = rank_[x] < rank_[y] ? x : y, hi = lo == x ? y : x;
+            int mid = -1;
+            for (int k = first_[lo]; k < first_[lo + 1]; ++k)
+                if (to_[k] == hi)
+                {
+                    mid = mid_[k];
+                    break;
+                }
+            if (mid == -1)
+                path.push_back(y);
+            else
+            {
+                todo.push_back({mid, y});
+                todo.push_back({x, mid});
+            }
+        }
+    }
+
+    void prepareQuery()
+    {
+        for (int side = 0; side < 2; ++side)
+        {
+            dist_[side].assign(rank_.size(), 0);
+            stamp_[side].assign(rank_.size(), 0);
+            parent_[side].assign(rank_.size(), -1);
+        }
+        round_ = 0;
+    }
+
+    // Whether arrays read back from a file can be walked by query() and
+    // unpack(): the arc ranges of each cell in order and inside to_, and
+    // every arc end and shortcut middle a cell of the grid.
+    bool validArcs() const
+    {
+        const int V = static_cast<int>(rank_.size()), arcs = static_cast<int>(to_.size());
+        if (first_[0] != 0 || first_[V] != arcs)
+            return false;
+        for (int u = 0; u < V; ++u)
+            if (first_[u] > first_[u + 1] || rank_[u] < -1 || rank_[u] >= V)
+                return false;
+        for (int k = 0; k < arcs; ++k)
+            if (to_[k] < 0 || to_[k] >= V || arc_cost_[k] < 0 || mid_[k] < -1 || mid_[k] >= V)
+                return false;
+        return true;
+    }
+
+    static bool readInts(FILE *f, std::vector<int> &v)
+    {
+        return fread(v.data(), sizeof(int), v.size(), f) == v.size();
+    }
+    static bool writeInts(FILE *f, const std::vector<int> &v)
+    {
+        return fwrite(v.data(), sizeof(int), v.size(), f) == v.size();
+    }
+
+    const Grid *grid_ = nullptr;
+    const PortalIndex *portals_ = nullptr;
+    int cost_[TERRAINS] = {};
+    uint64_t fingerprint_ = 0;
+    std::vector<int> rank_, first_, to_, arc_cost_, mid_;
+    std::vector<int> dist_[2], stamp_[2], parent_[2];
+    int round_ = 0;
+    long long settled_ = 0;
+};
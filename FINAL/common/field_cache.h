@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "fingerprint.h"
+#include "grid.h"
+#include "mapped_file.h"
+
+// Distance field file (little endian):
+//   FieldHeader
+//   uint32 dist[cells]   one value per padded cell id, UINT32_MAX for unreached
+// The file name is the hex key fieldKey(fingerprint, goal), so a field is
+// found by content: any program that computes the same field for the same
+// terrain, tunnels, cost table and goal shares it, and after the map changes
+// the key changes with it and the old file is never looked up again. Such
+// stale files are removed by pruneFieldCache(), oldest use first. The header
+// repeats what the key was built from, which guards against collisions and
+// files renamed by hand.
+constexpr char FIELD_MAGIC[8] = {'K', 'K', 'A', 'F', 'I', 'E', 'L', 'D'};
+constexpr uint32_t FIELD_VERSION = 1;
+
+struct FieldHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width, height;
+    int32_t goal;
+    uint32_t reserved;
+    uint64_t fingerprint;
+    uint64_t cells;
+};
+
+inline uint64_t fieldKey(uint64_t fingerprint, int goal) { return fnv1a64(&goal, sizeof(goal), fingerprint); }
+
+// A goal-rooted distance field kept in a cache directory and mapped straight
+// from disk: opening one costs a few page faults for the cells a search
+// actually reads, not a pass over the map.
+class DistanceField
+{
+public:
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+
+    static std::string path(const std::string &dir, uint64_t fingerprint, int goal)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.field", static_cast<unsigned long long>(fieldKey(fingerprint, goal)));
+        return dir + "/" + name;
+    }
+
+    // Maps the field cached under dir for this map and goal; fails when there
+    // is none or the file does not describe them.
+    bool open(const std::string &dir, const Grid &grid, uint64_t fingerprint, int goal, std::string &error)
+    {
+        std::string file = path(dir, fingerprint, goal);
+        auto mapped = std::make_shared<MappedFile>();
+        if (!mapped->open(file, error, false))
+            return false;
+        FieldHeader h;
+        if (mapped->size() < sizeof(h))
+        {
+            error = file + ": not a distance field file";
+            return false;
+        }
+        memcpy(&h, mapped->data(), sizeof(h));
+        if (memcmp(h.magic, FIELD_MAGIC, sizeof(FIELD_MAGIC)) != 0 || h.version != FIELD_VERSION ||
+            h.header_size != sizeof(FieldHeader))
+        {
+            error = file + ": not a distance field file";
+            return false;
+        }
+        if (h.width != grid.X || h.height != grid.Y || h.goal != goal || h.fingerprint != fingerprint ||
+            h.cells != static_cast<uint64_t>(grid.size()) || mapped->size() != sizeof(h) + h.cells * sizeof(uint32_t))
+        {
+            error = file + ": cached for a different map";
+            return false;
+        }
+        // The modification time records the last use for pruneFieldCache().
+        std::error_code ec;
+        std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), ec);
+        own_.clear();
+        file_ = mapped;
+        data_ = reinterpret_cast<const uint32_t *>(mapped->data() + sizeof(h));
+        return true;
+    }
+
+    // Stores dist (values of UNREACHED or more, and negative ones, become
+    // UNREACHED) under dir and maps it. If the file cannot be written the
+    // field is kept in memory and the error reported.
+    template <typename T>
+    bool store(const std::string &dir, const Grid &grid, uint64_t fingerprint, int goal, const std::vector<T> &dist,
+               std::string &error)
+    {
+        std::vector<uint32_t> values(dist.size());
+        for (size_t v = 0; v < dist.size(); ++v)
+            values[v] = dist[v] < 0 || static_cast<unsigned long long>(dist[v]) >= UNREACHED
+                            ? UNREACHED
+                            : static_cast<uint32_t>(dist[v]);
+        FieldHeader h{};
+        memcpy(h.magic, FIELD_MAGIC, sizeof(h.magic));
+        h.version = FIELD_VERSION;
+        h.header_size = sizeof(FieldHeader);
+        h.width = grid.X;
+        h.height = grid.Y;
+        h.goal = goal;
+        h.fingerprint = fingerprint;
+        h.cells = values.size();
+
+        // Written under a temporary name and renamed, so a process reading
+        // the cache at the same time never sees half a file.
+        std::string file = path(dir, fingerprint, goal);
+        std::string temp = file + "." + std::to_string(std::random_device{}()) + ".tmp";
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        FILE *f = fopen(temp.c_str(), "wb");
+        bool ok = f != nullptr && fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  fwrite(values.data(), sizeof(uint32_t), values.size(), f) == values.size();
+        if (f != nullptr && fclose(f) != 0)
+            ok = false;
+        if (ok)
+        {
+            std::filesystem::rename(temp, file, ec);
+            ok = !ec;
+        }
+        if (!ok)
+        {
+            std::filesystem::remove(temp, ec);
+            error = file + ": cannot write distance field";
+        }
+        if (ok && open(dir, grid, fingerprint, goal, error))
+            return true;
+        file_.reset();
+        own_ = std::move(values);
+        data_ = own_.data();
+        return false;
+    }
+
+    uint32_t operator[](int v) const { return data_[v]; }
+
+private:
+    std::shared_ptr<MappedFile> file_;
+    std::vector<uint32_t> own_;
+    const uint32_t *data_ = nullptr;
+};
+
+// Deletes the least recently used fields under dir until the rest take at
+// most max_bytes. Fields of the given fingerprint, the map being searched, are
+// always kept, as are files that cannot be read or removed (on Windows a field
+// another process has mapped). Temporary files of unfinished writes are left
+// alone.
+inline void pruneFieldCache(const std::string &dir, uint64_t fingerprint, uint64_t max_bytes)
+{
+    struct Entry
+    {
+        std::filesystem::file_time_type used;
+        uint64_t bytes;
+        std::filesystem::path file;
+    };
+    std::vector<Entry> stale;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const std::filesystem::path &file = it->path();
+        if (file.extension() != ".field")
+            continue;
+        uint64_t bytes = it->file_size(ec);
+        if (ec)
+        {
+            ec.clear();
+            continue;
+        }
+        total += bytes;
+        FieldHeader h;
+        FILE *f = fopen(file.string().c_str(), "rb");
+        bool current = f != nullptr && fread(&h, sizeof(h), 1, f) == 1 && h.fingerprint == fingerprint;
+        if (f != nullptr)
+            fclose(f);
+        std::error_code time_ec;
+        auto used = it->last_write_time(time_ec);
+        if (!current && !time_ec)
+            stale.push_back({used, bytes, file});
+    }
+    std::sort(stale.begin(), stale.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &e : stale)
+    {
+        if (total <= max_bytes)
+            break;
+        if (std::filesystem::remove(e.file, ec))
+            total -= e.bytes;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "grid.h"
+#include "portals.h"
+
+// FNV-1a over a byte range, continuing from h.
+inline uint64_t fnv1a64(const void *data, size_t size, uint64_t h = 1469598103934665603ull)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Entries of a cost table: one per terrain byte. The text format only has
+// terrain 0..9, but a binary map can hold any byte, so tables indexed with
+// grid[v] cover them all.
+constexpr int TERRAINS = 256;
+
+// cost(t) for every terrain byte t as a table of ints, -1 for impassable
+// terrain: terrain 5 and any cost of INT_MAX or more.
+template <typename Cost>
+inline void costTable(Cost cost, int (&table)[TERRAINS])
+{
+    for (int t = 0; t < TERRAINS; ++t)
+    {
+        long long w = cost(t);
+        table[t] = t == 5 || w >= INT_MAX || w < 0 ? -1 : static_cast<int>(w);
+    }
+}
+
+// Hash of everything a table precomputed for a map depends on: the terrain,
+// the tunnels and the cost table from costTable().
+// Files written next to a map store it and are refused when it changes.
+inline uint64_t mapFingerprint(const Grid &grid, const PortalIndex *portals, const int (&cost)[TERRAINS])
+{
+    uint64_t h = fnv1a64(cost, sizeof(cost));
+    h = fnv1a64(grid.cells, grid.size(), h);
+    if (portals != nullptr && !portals->empty())
+    {
+        h = fnv1a64(portals->mouth.data(), portals->mouth.size() * sizeof(uint64_t), h);
+        h = fnv1a64(portals->exits.data(), portals->exits.size() * sizeof(int), h);
+    }
+    return h;
+}
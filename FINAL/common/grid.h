@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct Coordinate
+{
+    int x, y;
+};
+struct Tunnel
+{
+    Coordinate A, B;
+};
+
+// Terrain map stored row-major, one byte per cell, inside a one-cell border of
+// obstacles (terrain 5). Rows are stride = X + 2 bytes apart and cell (x, y)
+// has id (y + 1) * stride + x + 1, so every cell of the map has all four
+// neighbours at id -stride, -1, +stride and +1 without any bounds check; ids
+// only ever leave the grid through coord(). size() counts the border cells
+// too and is the length per-cell search arrays need.
+// The bytes live either in an owned buffer or in a mapped map file; owner
+// keeps whichever it is alive, so copies of a Grid are cheap and share it.
+struct Grid
+{
+    int X = 0, Y = 0, stride = 0;
+    const uint8_t *cells = nullptr;
+    std::shared_ptr<const void> owner;
+
+    // Allocates a width x height map with its border set to 5 and the inside
+    // to 0; returns the bytes to fill in, addressed by id().
+    uint8_t *assign(int width, int height)
+    {
+        X = width;
+        Y = height;
+        stride = X + 2;
+        auto buf = std::make_shared<std::vector<uint8_t>>(paddedSize(X, Y), 5);
+        for (int y = 0; y < Y; ++y)
+            std::fill_n(buf->data() + id(0, y), X, uint8_t(0));
+        cells = buf->data();
+        owner = buf;
+        return buf->data();
+    }
+    static size_t paddedSize(long long width, long long height) { return static_cast<size_t>((width + 2) * (height + 2)); }
+    int size() const { return stride * (Y + 2); }
+    int id(int x, int y) const { return (y + 1) * stride + x + 1; }
+    int xOf(int id) const { return id % stride - 1; }
+    int yOf(int id) const { return id / stride - 1; }
+    Coordinate coord(int id) const { return {xOf(id), yOf(id)}; }
+    uint8_t operator[](int id) const { return cells[id]; }
+};
+
+// Calls visit(v) for every 4-connected neighbour v of u in the order up, left,
+// down, right, skipping obstacles (terrain 5). The border makes the map edge an
+// ordinary obstacle test. Nothing is allocated.
+template <typename Visit>
+inline void forEachNeighbor(const Grid &grid, int u, Visit visit)
+{
+    const int S = grid.stride;
+    if (grid[u - S] != 5)
+        visit(u - S);
+    if (grid[u - 1] != 5)
+        visit(u - 1);
+    if (grid[u + S] != 5)
+        visit(u + S);
+    if (grid[u + 1] != 5)
+        visit(u + 1);
+}
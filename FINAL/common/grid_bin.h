@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "grid.h"
+#include "mapped_file.h"
+
+// Precompiled map file (little endian):
+//   GridBinHeader
+//   int32 x, y           per Pokemon
+//   int32 ax, ay, bx, by per tunnel
+//   padding to a 64-byte boundary
+//   uint8 terrain[(width + 2) * (height + 2)], row-major, in Grid's layout:
+//         the map surrounded by a one-cell border of obstacles (terrain 5)
+// Loading maps the file and points Grid::cells at the terrain bytes, so no
+// parsing happens at all. Start and goal are stored as coordinates (-1 when
+// absent) so that maps beyond 2^31 cells can be described too.
+constexpr char GRID_BIN_MAGIC[8] = {'K', 'K', 'A', 'G', 'R', 'I', 'D', '\0'};
+constexpr uint32_t GRID_BIN_VERSION = 3;
+
+struct GridBinHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int32_t width, height;
+    int32_t start_x, start_y, goal_x, goal_y;
+    uint32_t pokemon_count, tunnel_count;
+    uint64_t pokemon_offset, tunnel_offset, terrain_offset;
+};
+
+inline bool isGridBinary(const char *data, size_t size)
+{
+    return size >= sizeof(GRID_BIN_MAGIC) && memcmp(data, GRID_BIN_MAGIC, sizeof(GRID_BIN_MAGIC)) == 0;
+}
+
+inline GridBinHeader makeGridBinHeader(int32_t width, int32_t height, Coordinate start, Coordinate goal,
+                                       uint32_t pokemon_count, uint32_t tunnel_count)
+{
+    GridBinHeader h{};
+    memcpy(h.magic, GRID_BIN_MAGIC, sizeof(h.magic));
+    h.version = GRID_BIN_VERSION;
+    h.header_size = sizeof(GridBinHeader);
+    h.width = width;
+    h.height = height;
+    h.start_x = start.x;
+    h.start_y = start.y;
+    h.goal_x = goal.x;
+    h.goal_y = goal.y;
+    h.pokemon_count = pokemon_count;
+    h.tunnel_count = tunnel_count;
+    h.pokemon_offset = sizeof(GridBinHeader);
+    h.tunnel_offset = h.pokemon_offset + 8ull * h.pokemon_count;
+    h.terrain_offset = (h.tunnel_offset + 16ull * h.tunnel_count + 63) & ~63ull;
+    return h;
+}
+
+inline bool writeGridBinary(const std::string &filename, const Grid &grid, int start_id, int goal_id,
+                            const std::vector<Coordinate> &pokemons, const std::vector<Tunnel> &tunnels,
+                            std::string &error)
+{
+    Coordinate s = start_id < 0 ? Coordinate{-1, -1} : grid.coord(start_id);
+    Coordinate g = goal_id < 0 ? Coordinate{-1, -1} : grid.coord(goal_id);
+    GridBinHeader h = makeGridBinHeader(grid.X, grid.Y, s, g, static_cast<uint32_t>(pokemons.size()),
+                                        static_cast<uint32_t>(tunnels.size()));
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    if (f == nullptr)
+    {
+        error = filename + ": cannot create file";
+        return false;
+    }
+    std::vector<int32_t> ints;
+    for (auto &c : pokemons)
+        ints.insert(ints.end(), {c.x, c.y});
+    for (auto &t : tunnels)
+        ints.insert(ints.end(), {t.A.x, t.A.y, t.B.x, t.B.y});
+    std::vector<char> pad(h.terrain_offset - h.tunnel_offset - 16ull * h.tunnel_count, 0);
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+              fwrite(ints.data(), sizeof(int32_t), ints.size(), f) == ints.size() &&
+              fwrite(pad.data(), 1, pad.size(), f) == pad.size() &&
+              fwrite(grid.cells, 1, grid.size(), f) == static_cast<size_t>(grid.size());
+    ok = (fclose(f) == 0) && ok;
+    if (!ok)
+        error = filename + ": write failed";
+    return ok;
+}
+
+// Takes a mapped file whose contents pass isGridBinary(); the Grid keeps the mapping alive.
+inline bool readGridBinary(const std::shared_ptr<MappedFile> &file, const std::string &filename, Grid &grid,
+                           int &start_id, int &goal_id, std::vector<Coordinate> &pokemons,
+                           std::vector<Tunnel> &tunnels, std::string &error)
+{
+    const char *data = file->data();
+    size_t size = file->size();
+    GridBinHeader h;
+    if (size < sizeof(h) || !isGridBinary(data, size))
+    {
+        error = filename + ": not a binary grid file";
+        return false;
+    }
+    memcpy(&h, data, sizeof(h));
+    if (h.version != GRID_BIN_VERSION)
+    {
+        error = filename + ": unsupported binary grid version " + std::to_string(h.version);
+        return false;
+    }
+    if (h.width <= 0 || h.height <= 0)
+    {
+        error = filename + ": invalid grid size";
+        return false;
+    }
+    uint64_t V = Grid::paddedSize(h.width, h.height);
+    if (V > INT32_MAX)
+    {
+        error = filename + ": " + std::to_string(static_cast<uint64_t>(h.width) * static_cast<uint64_t>(h.height)) +
+                " cells do not fit an in-memory Grid, use the tiled backend";
+        return false;
+    }
+    if (h.pokemon_offset + 8ull * h.pokemon_count > size ||
+        h.tunnel_offset + 16ull * h.tunnel_count > size ||
+        h.terrain_offset + V > size || h.header_size != sizeof(GridBinHeader))
+    {
+        error = filename + ": truncated or corrupt binary grid";
+        return false;
+    }
+    auto inside = [&h](int32_t x, int32_t y)
+    { return (x == -1 && y == -1) || (x >= 0 && y >= 0 && x < h.width && y < h.height); };
+    if (!inside(h.start_x, h.start_y) || !inside(h.goal_x, h.goal_y))
+    {
+        error = filename + ": start or goal outside the grid";
+        return false;
+    }
+
+    // A point must be a cell of the map; start and goal may also be absent.
+    auto cell = [&inside](int32_t x, int32_t y) { return x >= 0 && inside(x, y); };
+    const int32_t *pk = reinterpret_cast<const int32_t *>(data + h.pokemon_offset);
+    std::vector<Coordinate> read_pokemons;
+    for (uint32_t i = 0; i < h.pokemon_count; ++i)
+    {
+        if (!cell(pk[2 * i], pk[2 * i + 1]))
+        {
+            error = filename + ": Pokemon outside the grid";
+            return false;
+        }
+        read_pokemons.push_back({pk[2 * i], pk[2 * i + 1]});
+    }
+    const int32_t *tn = reinterpret_cast<const int32_t *>(data + h.tunnel_offset);
+    std::vector<Tunnel> read_tunnels;
+    for (uint32_t i = 0; i < h.tunnel_count; ++i)
+    {
+        if (!cell(tn[4 * i], tn[4 * i + 1]) || !cell(tn[4 * i + 2], tn[4 * i + 3]))
+        {
+            error = filename + ": tunnel endpoint outside the grid";
+            return false;
+        }
+        read_tunnels.push_back({{tn[4 * i], tn[4 * i + 1]}, {tn[4 * i + 2], tn[4 * i + 3]}});
+    }
+
+    // Checked on a local Grid, so a failed load leaves grid untouched rather
+    // than pointing into a mapping the caller is about to drop.
+    Grid loaded;
+    loaded.X = h.width;
+    loaded.Y = h.height;
+    loaded.stride = h.width + 2;
+    loaded.cells = reinterpret_cast<const uint8_t *>(data + h.terrain_offset);
+    // The searches rely on the border to stop at the map edge.
+    const int last = loaded.size() - loaded.stride;
+    bool walled = true;
+    for (int i = 0; i < loaded.stride; ++i)
+        walled = walled && loaded[i] == 5 && loaded[last + i] == 5;
+    for (int y = 0; y < loaded.Y; ++y)
+        walled = walled && loaded[loaded.id(-1, y)] == 5 && loaded[loaded.id(loaded.X, y)] == 5;
+    if (!walled)
+    {
+        error = filename + ": corrupt binary grid, border cells must be obstacles";
+        return false;
+    }
+    loaded.owner = file;
+    grid = std::move(loaded);
+    pokemons = std::move(read_pokemons);
+    tunnels = std::move(read_tunnels);
+    start_id = h.start_x < 0 ? -1 : grid.id(h.start_x, h.start_y);
+    goal_id = h.goal_x < 0 ? -1 : grid.id(h.goal_x, h.goal_y);
+    return true;
+}
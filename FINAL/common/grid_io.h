@@ -0,0 +1,16 @@
+#pragma once
+
+#include "grid_bin.h"
+#include "grid_text.h"
+
+// Loads either a grid.txt or a precompiled binary map, picked by the file's magic bytes.
+inline bool loadGrid(const std::string &filename, Grid &grid, int &start_id, int &goal_id,
+                     std::vector<Coordinate> &pokemons, std::vector<Tunnel> &tunnels, std::string &error)
+{
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(filename, error))
+        return false;
+    if (isGridBinary(file->data(), file->size()))
+        return readGridBinary(file, filename, grid, start_id, goal_id, pokemons, tunnels, error);
+    return parseGridText(file->data(), file->size(), filename, grid, start_id, goal_id, pokemons, tunnels, error);
+}
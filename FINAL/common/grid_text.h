@@ -0,0 +1,186 @@
+#pragma once
+
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRID_TEXT_SSE2 1
+#endif
+
+#include "grid.h"
+#include "mapped_file.h"
+
+// grid.txt layout: "X Y" followed by X * Y whitespace separated tokens, each a
+// single terrain digit or S (start), G (goal), P (Pokemon). S, G and P stand on
+// terrain 1. The grid may be followed by tunnel lines "T ax ay bx by".
+namespace grid_text
+{
+    inline bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    inline std::string where(const char *begin, const char *at)
+    {
+        int line = 1, col = 1;
+        for (const char *p = begin; p < at; ++p)
+        {
+            if (*p == '\n')
+            {
+                ++line;
+                col = 1;
+            }
+            else
+                ++col;
+        }
+        return std::to_string(line) + ":" + std::to_string(col);
+    }
+
+    inline bool readInt(const char *&p, const char *end, int &out)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+        long long v = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            v = v * 10 + (*p - '0');
+            if (v > INT_MAX)
+                return false;
+            ++p;
+        }
+        if (p < end && !isSpace(*p))
+            return false;
+        out = static_cast<int>(v);
+        return true;
+    }
+
+#ifdef GRID_TEXT_SSE2
+    // Decodes eight "d " tokens at once. Returns false (and writes nothing)
+    // unless all 16 bytes are digit/space pairs.
+    inline bool decodeRun8(const char *p, uint8_t *out)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        // Little endian: the low byte of each 16-bit lane is the digit, the high byte the space.
+        __m128i d = _mm_sub_epi8(v, _mm_set1_epi16(0x2030));
+        __m128i limit = _mm_set1_epi16(0x0009);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, limit), limit)) != 0xFFFF)
+            return false;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(d, d));
+        return true;
+    }
+#endif
+}
+
+// Parses a grid.txt image in place. On failure error holds "name:line:col: reason".
+inline bool parseGridText(const char *data, size_t size, const std::string &name, Grid &grid,
+                          int &start_id, int &goal_id, std::vector<Coordinate> &pokemons,
+                          std::vector<Tunnel> &tunnels, std::string &error)
+{
+    using namespace grid_text;
+    const char *p = data, *end = data + size;
+    start_id = -1;
+    goal_id = -1;
+    pokemons.clear();
+    tunnels.clear();
+
+    int X, Y;
+    if (!readInt(p, end, X) || !readInt(p, end, Y) || X == 0 || Y == 0)
+    {
+        error = name + ":" + where(data, p) + ": expected positive width and height";
+        return false;
+    }
+    if (Grid::paddedSize(X, Y) > INT_MAX)
+    {
+        error = name + ": grid " + std::to_string(X) + "x" + std::to_string(Y) + " is too large";
+        return false;
+    }
+    uint8_t *out = grid.assign(X, Y);
+    const int V = X * Y;
+    int v = 0, x = 0;
+    uint8_t *row = out + grid.id(0, 0);
+    while (v < V)
+    {
+        if (x == X)
+        {
+            x = 0;
+            row += grid.stride;
+        }
+        while (p < end && isSpace(*p))
+            ++p;
+#ifdef GRID_TEXT_SSE2
+        if (X - x >= 8 && end - p >= 16 && decodeRun8(p, row + x))
+        {
+            p += 16;
+            v += 8;
+            x += 8;
+            continue;
+        }
+#endif
+        if (p == end)
+        {
+            error = name + ": expected " + std::to_string(V) + " cells, found " + std::to_string(v);
+            return false;
+        }
+        char c = *p;
+        if (p + 1 < end && !isSpace(p[1]))
+        {
+            const char *q = p;
+            while (q < end && !isSpace(*q))
+                ++q;
+            error = name + ":" + where(data, p) + ": invalid cell '" + std::string(p, q) + "'";
+            return false;
+        }
+        if (c >= '0' && c <= '9')
+            row[x] = static_cast<uint8_t>(c - '0');
+        else if (c == 'S' || c == 'G' || c == 'P')
+        {
+            row[x] = 1;
+            if (c == 'P')
+                pokemons.push_back({x, v / X});
+            else
+            {
+                int &slot = (c == 'S') ? start_id : goal_id;
+                if (slot != -1)
+                {
+                    error = name + ":" + where(data, p) + ": duplicate '" + c + "'";
+                    return false;
+                }
+                slot = static_cast<int>(row + x - out);
+            }
+        }
+        else
+        {
+            error = name + ":" + where(data, p) + ": invalid cell '" + std::string(1, c) + "'";
+            return false;
+        }
+        ++p;
+        ++v;
+        ++x;
+    }
+    while (true)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+        if (p == end)
+            break;
+        const char *line = p;
+        int c[4];
+        bool ok = *p == 'T' && ++p < end && isSpace(*p);
+        for (int i = 0; ok && i < 4; ++i)
+            ok = readInt(p, end, c[i]);
+        if (!ok)
+        {
+            error = name + ":" + where(data, line) + ": expected tunnel \"T ax ay bx by\" after " + std::to_string(V) + " cells";
+            return false;
+        }
+        if (c[0] >= X || c[1] >= Y || c[2] >= X || c[3] >= Y)
+        {
+            error = name + ":" + where(data, line) + ": tunnel endpoint outside the grid";
+            return false;
+        }
+        tunnels.push_back({{c[0], c[1]}, {c[2], c[3]}});
+    }
+    return true;
+}
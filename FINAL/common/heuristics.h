@@ -0,0 +1,102 @@
+#pragma once
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "alt.h"
+#include "field_cache.h"
+#include "grid.h"
+
+// Heuristic policies for A*. Each is a small value type bound to one goal
+// whose operator()(v) estimates the cost from cell v to that goal when A*
+// pushes v; A* is templated on the type, so the call inlines. NO_BOUND means
+// nothing is known and counts as 0.
+// The analytic policies keep no per-cell state. Like the Euclidean field they
+// replace they ignore tunnels, so on maps with tunnels they can overestimate.
+constexpr long long NO_BOUND = LLONG_MAX / 4;
+
+// Cheapest step on the map: the smallest cost(t) over the terrain present,
+// 1 when nothing is passable. Scales the analytic policies to the terrain.
+template <typename Cost>
+inline long long minStepCost(const Grid &grid, Cost cost)
+{
+    bool present[256] = {};
+    for (int v = 0; v < grid.size(); ++v)
+        present[grid[v]] = true;
+    long long best = LLONG_MAX;
+    for (int t = 0; t < 256; ++t)
+        if (present[t] && cost(t) < best)
+            best = cost(t);
+    return best <= 0 || best >= NO_BOUND ? 1 : best;
+}
+
+// h = 0: A* becomes uniform-cost search.
+struct ZeroHeuristic
+{
+    long long operator()(int) const { return 0; }
+};
+
+// Manhattan distance to the goal times the cheapest step.
+class ManhattanHeuristic
+{
+public:
+    ManhattanHeuristic(const Grid &grid, int goal, long long unit)
+        : stride_(grid.stride), gx_(goal % grid.stride), gy_(goal / grid.stride), unit_(unit) {}
+    long long operator()(int v) const { return (std::abs(v % stride_ - gx_) + std::abs(v / stride_ - gy_)) * unit_; }
+
+private:
+    int stride_, gx_, gy_;
+    long long unit_;
+};
+
+// Straight-line distance to the goal times the cheapest step, rounded up.
+class EuclideanHeuristic
+{
+public:
+    EuclideanHeuristic(const Grid &grid, int goal, long long unit)
+        : stride_(grid.stride), gx_(goal % grid.stride), gy_(goal / grid.stride), unit_(unit) {}
+    long long operator()(int v) const
+    {
+        double dx = v % stride_ - gx_;
+        double dy = v / stride_ - gy_;
+        return static_cast<long long>(std::ceil(std::sqrt(dx * dx + dy * dy) * double(unit_)));
+    }
+
+private:
+    int stride_, gx_, gy_;
+    long long unit_;
+};
+
+// Reads a per-cell table computed for the goal beforehand: a vector of costs
+// with NO_BOUND for unreached cells, or a mapped DistanceField.
+template <typename Table>
+class FieldHeuristic
+{
+public:
+    explicit FieldHeuristic(const Table &table) : table_(&table) {}
+    long long operator()(int v) const { return value((*table_)[v]); }
+
+private:
+    static long long value(long long h) { return h; }
+    static long long value(uint32_t d) { return d == DistanceField::UNREACHED ? NO_BOUND : d; }
+
+    const Table *table_;
+};
+
+using TableHeuristic = FieldHeuristic<std::vector<long long>>;
+using MappedHeuristic = FieldHeuristic<DistanceField>;
+
+// ALT triangle bound from precomputed landmark tables.
+class LandmarkHeuristic
+{
+public:
+    LandmarkHeuristic(const Landmarks &landmarks, int goal) : landmarks_(&landmarks), goal_(goal) {}
+    long long operator()(int v) const { return landmarks_->bound(v, goal_); }
+
+private:
+    const Landmarks *landmarks_;
+    int goal_;
+};
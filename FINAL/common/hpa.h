@@ -0,0 +1,408 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+
+#include "bucket_queue.h"
+#include "fingerprint.h"
+#include "grid.h"
+#include "portals.h"
+
+// Hierarchical path-finding (HPA*) with weighted cells: entering a cell costs
+// the weight of its terrain. The map is cut into cluster x cluster blocks.
+// Where two neighbouring blocks share a run of border cells that are passable
+// on both sides, the run gets one entrance (its middle cell) or, from six
+// cells on, two (its ends). Each entrance is a pair of abstract nodes, one per
+// side, linked across the border. Tunnel mouths are abstract nodes too, linked
+// by their tunnels. build() stores for every block the cost between each two
+// of its nodes, found by a search that stays inside the block.
+//
+// A query links start and goal to the nodes of their own blocks, runs A* on
+// the abstract graph and turns every abstract edge back into cells with a
+// search inside one block. Paths are near-optimal. With exact set, every
+// border cell pair is an entrance, so the abstract distances and the paths
+// are optimal, at the cost of a much larger graph.
+class HierarchicalMap
+{
+public:
+    // cost(t) is the weight of terrain t; values of INT_MAX or more mark
+    // impassable terrain, and terrain 5 always is.
+    template <typename Cost>
+    void build(const Grid &grid, const PortalIndex *portals, int cluster, bool exact, Cost cost)
+    {
+        grid_ = &grid;
+        C_ = cluster;
+        nx_ = (grid.X + C_ - 1) / C_;
+        ny_ = (grid.Y + C_ - 1) / C_;
+        costTable(cost, cost_);
+        min_step_ = INT_MAX;
+        max_step_ = 1;
+        for (int t = 0; t < TERRAINS; ++t)
+            if (cost_[t] >= 0)
+            {
+                min_step_ = std::min(min_step_, cost_[t]);
+                max_step_ = std::max(max_step_, cost_[t]);
+            }
+        if (min_step_ == INT_MAX)
+            min_step_ = 1;
+        queue_ = BucketQueue(max_step_);
+
+        std::vector<std::vector<int>> cells(nx_ * ny_);
+        std::vector<std::pair<int, int>> links;
+        auto entrance = [&](int a, int b)
+        {
+            cells[clusterOf(a)].push_back(a);
+            cells[clusterOf(b)].push_back(b);
+            links.push_back({a, b});
+            links.push_back({b, a});
+        };
+        for (int x = C_; x < grid.X; x += C_)
+            for (int y0 = 0; y0 < grid.Y; y0 += C_)
+                addEntrances(grid.id(x - 1, y0), grid.id(x, y0), grid.stride, std::min(C_, grid.Y - y0), exact, entrance);
+        for (int y = C_; y < grid.Y; y += C_)
+            for (int x0 = 0; x0 < grid.X; x0 += C_)
+                addEntrances(grid.id(x0, y - 1), grid.id(x0, y), 1, std::min(C_, grid.X - x0), exact, entrance);
+        mouth_dist_.clear();
+        if (portals != nullptr && !portals->empty())
+        {
+            mouth_dist_ = mouthDistances(grid, *portals);
+            for (size_t w = 0; w < portals->mouth.size(); ++w)
+                for (uint64_t bits = portals->mouth[w]; bits != 0; bits &= bits - 1)
+                {
+                    int m = static_cast<int>(w * 64) + ctz64(bits);
+                    if (blocked(m))
+                        continue;
+                    cells[clusterOf(m)].push_back(m);
+                    portals->forEachExit(m, [&](int b)
+                    {
+                        if (!blocked(b))
+                            links.push_back({m, b});
+                    });
+                }
+        }
+
+        // Nodes are numbered block by block, by cell id within a block.
+        first_.assign(nx_ * ny_ + 1, 0);
+        cell_.clear();
+        for (int c = 0; c < nx_ * ny_; ++c)
+        {
+            std::sort(cells[c].begin(), cells[c].end());
+            cells[c].erase(std::unique(cells[c].begin(), cells[c].end()), cells[c].end());
+            cell_.insert(cell_.end(), cells[c].begin(), cells[c].end());
+            first_[c + 1] = static_cast<int>(cell_.size());
+            std::vector<int>().swap(cells[c]);
+        }
+        const int N = static_cast<int>(cell_.size());
+
+        link_first_.assign(N + 1, 0);
+        for (auto &l : links)
+            link_first_[nodeOf(l.first) + 1]++;
+        for (int i = 0; i < N; ++i)
+            link_first_[i + 1] += link_first_[i];
+        link_to_.assign(links.size(), 0);
+        std::vector<int> next(link_first_.begin(), link_first_.end() - 1);
+        for (auto &l : links)
+            link_to_[next[nodeOf(l.first)]++] = nodeOf(l.second);
+
+        // Block matrices: row i of block c holds the in-block cost from its
+        // i-th node to each of its nodes, INT_MAX when there is none.
+        matrix_first_.assign(nx_ * ny_ + 1, 0);
+        for (int c = 0; c < nx_ * ny_; ++c)
+        {
+            size_t k = first_[c + 1] - first_[c];
+            matrix_first_[c + 1] = matrix_first_[c] + k * k;
+        }
+        matrix_.assign(matrix_first_.back(), INT_MAX);
+        W_ = C_ + 2;
+        frame_.assign(W_ * W_, -1);
+        dist_.assign(W_ * W_, INT_MAX);
+        from_.assign(W_ * W_, -1);
+        framed_ = -1;
+        // Moves can be walked back and a step costs the cell it enters, so
+        // the cost from j to i is the cost from i to j plus cost(i) - cost(j).
+        // The search from node i therefore only has to settle the nodes after i.
+        std::vector<int> rank(W_ * W_, -1);
+        for (int c = 0; c < nx_ * ny_; ++c)
+        {
+            const int k = first_[c + 1] - first_[c];
+            int *m = matrix_.data() + matrix_first_[c];
+            loadFrame(c);
+            std::vector<int> at(k);
+            for (int j = 0; j < k; ++j)
+            {
+                at[j] = local(c, cell_[first_[c] + j]);
+                rank[at[j]] = j;
+            }
+            for (int i = 0; i < k; ++i)
+            {
+                int left = k - 1 - i;
+                if (left > 0)
+                    search(c, cell_[first_[c] + i], false, [&](int v)
+                    { return rank[v] > i && --left == 0; });
+                m[i * k + i] = 0;
+                for (int j = i + 1; j < k; ++j)
+                {
+                    int d = dist_[at[j]];
+                    m[i * k + j] = d;
+                    m[j * k + i] = d == INT_MAX ? INT_MAX : d + frame_[at[i]] - frame_[at[j]];
+                }
+            }
+            for (int j = 0; j < k; ++j)
+                rank[at[j]] = -1;
+        }
+        stamp_.assign(N + 2, 0);
+        g_.assign(N + 2, 0);
+        parent_.assign(N + 2, -1);
+        step_.assign(N + 2, 0);
+        round_ = 0;
+    }
+
+    int nodes() const { return static_cast<int>(cell_.size()); }
+    size_t edges() const { return link_to_.size() + matrix_.size(); }
+
+    // Path from start_id to goal_id as cell ids and its cost, or an empty path
+    // when the goal cannot be reached.
+    std::vector<int> path(int start_id, int goal_id, long long &cost)
+    {
+        struct Item
+        {
+            long long f, g;
+            int id;
+            bool operator<(const Item &o) const { return f != o.f ? f > o.f : g < o.g; }
+        };
+        const int N = nodes(), S = N, T = N + 1;
+        opened_ = 0;
+        cost = 0;
+        std::vector<int> ids;
+        if (start_id == goal_id)
+        {
+            ids.push_back(start_id);
+            return ids;
+        }
+        goal_ = goal_id;
+        const int cs = clusterOf(start_id), ct = clusterOf(goal_id);
+        auto never = [](int) { return false; };
+        search(cs, start_id, false, never);
+        std::vector<int> from_start(first_[cs + 1] - first_[cs]);
+        for (size_t j = 0; j < from_start.size(); ++j)
+            from_start[j] = dist_[local(cs, cell_[first_[cs] + j])];
+        int direct = cs == ct ? dist_[local(cs, goal_id)] : INT_MAX;
+        search(ct, goal_id, true, never);
+        std::vector<int> to_goal(first_[ct + 1] - first_[ct]);
+        for (size_t j = 0; j < to_goal.size(); ++j)
+            to_goal[j] = dist_[local(ct, cell_[first_[ct] + j])];
+
+        ++round_;
+        std::priority_queue<Item> open;
+        auto relax = [&](int v, long long g, int u, bool step)
+        {
+            if (stamp_[v] == round_ && g_[v] <= g)
+                return;
+            stamp_[v] = round_;
+            g_[v] = g;
+            parent_[v] = u;
+            step_[v] = step;
+            open.push({g + (v == T ? 0 : heuristic(v == S ? start_id : cell_[v])), g, v});
+        };
+        relax(S, 0, -1, false);
+        while (!open.empty())
+        {
+            Item cur = open.top();
+            open.pop();
+            int u = cur.id;
+            if (cur.g != g_[u])
+                continue;
+            opened_++;
+            if (u == T)
+                break;
+            if (u == S)
+            {
+                for (size_t j = 0; j < from_start.size(); ++j)
+                    if (from_start[j] != INT_MAX)
+                        relax(first_[cs] + static_cast<int>(j), from_start[j], S, false);
+                if (direct != INT_MAX)
+                    relax(T, direct, S, false);
+                continue;
+            }
+            int c = clusterOf(cell_[u]), i = u - first_[c], k = first_[c + 1] - first_[c];
+            const int *row = &matrix_[matrix_first_[c] + static_cast<size_t>(i) * k];
+            for (int j = 0; j < k; ++j)
+                if (j != i && row[j] != INT_MAX)
+                    relax(first_[c] + j, cur.g + row[j], u, false);
+            for (int e = link_first_[u]; e < link_first_[u + 1]; ++e)
+            {
+                int v = link_to_[e];
+                relax(v, cur.g + cost_[(*grid_)[cell_[v]]], u, true);
+            }
+            if (c == ct && to_goal[i] != INT_MAX)
+                relax(T, cur.g + to_goal[i], u, false);
+        }
+        if (stamp_[T] != round_)
+            return ids;
+        cost = g_[T];
+
+        // Abstract path back to cells: a step edge adds its end cell, any
+        // other edge is searched again inside its block.
+        std::vector<int> chain;
+        for (int v = T; v != -1; v = parent_[v])
+            chain.push_back(v);
+        std::reverse(chain.begin(), chain.end());
+        ids.push_back(start_id);
+        for (size_t n = 1; n < chain.size(); ++n)
+        {
+            int a = chain[n - 1] == S ? start_id : cell_[chain[n - 1]];
+            int b = chain[n] == T ? goal_id : cell_[chain[n]];
+            if (step_[chain[n]])
+            {
+                ids.push_back(b);
+                continue;
+            }
+            int c = clusterOf(a);
+            int target = local(c, b);
+            search(c, a, false, [&](int v)
+            { return v == target; });
+            size_t mark = ids.size();
+            for (int v = local(c, b); v != local(c, a); v = from_[v])
+                ids.push_back(cellAt(c, v));
+            std::reverse(ids.begin() + mark, ids.end());
+        }
+        return ids;
+    }
+
+    // Abstract nodes expanded plus cells settled by in-block searches in the
+    // last path() call.
+    long long opened() const { return opened_; }
+
+private:
+    bool blocked(int v) const { return cost_[(*grid_)[v]] < 0; }
+    int clusterOf(int v) const { return grid_->yOf(v) / C_ * nx_ + grid_->xOf(v) / C_; }
+    // Cells of block c in a frame one cell wider on every side.
+    int local(int c, int v) const { return (grid_->yOf(v) - c / nx_ * C_ + 1) * W_ + grid_->xOf(v) - c % nx_ * C_ + 1; }
+    int cellAt(int c, int lv) const { return grid_->id(c % nx_ * C_ + lv % W_ - 1, c / nx_ * C_ + lv / W_ - 1); }
+    int nodeOf(int v) const
+    {
+        int c = clusterOf(v);
+        return static_cast<int>(std::lower_bound(cell_.begin() + first_[c], cell_.begin() + first_[c + 1], v) - cell_.begin());
+    }
+
+    // Entrances along a border of len cell pairs a0 + i * step | b0 + i * step.
+    template <typename Add>
+    void addEntrances(int a0, int b0, int step, int len, bool exact, Add add)
+    {
+        int run = -1;
+        for (int i = 0; i <= len; ++i)
+        {
+            bool open = i < len && !blocked(a0 + i * step) && !blocked(b0 + i * step);
+            if (open && exact)
+                add(a0 + i * step, b0 + i * step);
+            if (exact)
+                continue;
+            if (open && run == -1)
+                run = i;
+            if (open || run == -1)
+                continue;
+            int last = i - 1;
+            if (last - run + 1 < 6)
+            {
+                int mid = (run + last) / 2;
+                add(a0 + mid * step, b0 + mid * step);
+            }
+            else
+            {
+                add(a0 + run * step, b0 + run * step);
+                add(a0 + last * step, b0 + last * step);
+            }
+            run = -1;
+        }
+    }
+
+    // Loads the entry costs of block c into frame_; the frame border and
+    // blocked cells hold -1.
+    void loadFrame(int c)
+    {
+        if (framed_ == c)
+            return;
+        const Grid &grid = *grid_;
+        const int x0 = c % nx_ * C_, y0 = c / nx_ * C_;
+        const int w = std::min(C_, grid.X - x0), h = std::min(C_, grid.Y - y0);
+        std::fill(frame_.begin(), frame_.end(), -1);
+        for (int y = 0; y < h; ++y)
+        {
+            const uint8_t *row = grid.cells + grid.id(x0, y0 + y);
+            for (int x = 0; x < w; ++x)
+                frame_[(y + 1) * W_ + x + 1] = cost_[row[x]];
+        }
+        framed_ = c;
+    }
+
+    // Weighted search from source that never leaves block c. Forward,
+    // dist_ is the cost of reaching each cell; backward, the cost of getting
+    // from each cell to source. Stops early once done(local cell) returns
+    // true for a settled cell.
+    template <typename Done>
+    void search(int c, int source, bool backward, Done done)
+    {
+        loadFrame(c);
+        std::fill(dist_.begin(), dist_.end(), INT_MAX);
+        int s = local(c, source);
+        if (backward && frame_[s] < 0)
+            return;
+        queue_.clear();
+        dist_[s] = 0;
+        from_[s] = -1;
+        queue_.push(s, 0);
+        const int step[4] = {-W_, -1, W_, 1};
+        while (!queue_.empty())
+        {
+            long long d;
+            int u = queue_.pop(d);
+            if (d != dist_[u])
+                continue;
+            opened_++;
+            if (done(u))
+                break;
+            for (int v : {u + step[0], u + step[1], u + step[2], u + step[3]})
+            {
+                if (frame_[v] < 0)
+                    continue;
+                int nd = static_cast<int>(d) + frame_[backward ? u : v];
+                if (nd < dist_[v])
+                {
+                    dist_[v] = nd;
+                    from_[v] = u;
+                    queue_.push(v, nd);
+                }
+            }
+        }
+    }
+
+    // min_step times the Manhattan distance to the goal, or to the nearest
+    // tunnel mouth if that is closer.
+    long long heuristic(int v) const
+    {
+        int h = std::abs(grid_->xOf(v) - grid_->xOf(goal_)) + std::abs(grid_->yOf(v) - grid_->yOf(goal_));
+        if (!mouth_dist_.empty())
+            h = std::min(h, mouth_dist_[v]);
+        return static_cast<long long>(h) * min_step_;
+    }
+
+    const Grid *grid_ = nullptr;
+    int C_ = 0, nx_ = 0, ny_ = 0;
+    int cost_[TERRAINS] = {};
+    int min_step_ = 1, max_step_ = 1;
+    int goal_ = -1, round_ = 0;
+    long long opened_ = 0;
+    std::vector<int> cell_, first_, mouth_dist_;
+    std::vector<int> link_first_, link_to_;
+    std::vector<size_t> matrix_first_;
+    std::vector<int> matrix_;
+    int W_ = 0, framed_ = -1;
+    std::vector<int> frame_, dist_, from_;
+    BucketQueue queue_{5};
+    std::vector<int> stamp_, parent_;
+    std::vector<long long> g_;
+    std::vector<char> step_;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+
+// 4-ary min-heap over ids 0 .. n-1 with a position index, so a queued id can
+// have its key lowered in place (decrease-key) instead of being pushed again.
+// The heap never holds more than one entry per id. Ties come out in no
+// particular order.
+template <typename Key>
+class IndexedHeap
+{
+public:
+    explicit IndexedHeap(int n) : pos_(n, -1) {}
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+    bool contains(int id) const { return pos_[id] >= 0; }
+
+    // Queues id with key, or lowers its key if it is already queued with a larger one.
+    void push(int id, Key key)
+    {
+        int i = pos_[id];
+        if (i < 0)
+        {
+            i = static_cast<int>(heap_.size());
+            heap_.push_back({key, id});
+        }
+        else if (key < heap_[i].key)
+            heap_[i].key = key;
+        else
+            return;
+        siftUp(i);
+    }
+
+    // Removes the id with the smallest key and stores that key in key.
+    int pop(Key &key)
+    {
+        Entry top = heap_[0];
+        pos_[top.id] = -1;
+        Entry last = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty())
+        {
+            heap_[0] = last;
+            pos_[last.id] = 0;
+            siftDown(0);
+        }
+        key = top.key;
+        return top.id;
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        int id;
+    };
+
+    void siftUp(int i)
+    {
+        Entry e = heap_[i];
+        while (i > 0)
+        {
+            int parent = (i - 1) >> 2;
+            if (!(e.key < heap_[parent].key))
+                break;
+            heap_[i] = heap_[parent];
+            pos_[heap_[i].id] = i;
+            i = parent;
+        }
+        heap_[i] = e;
+        pos_[e.id] = i;
+    }
+
+    void siftDown(int i)
+    {
+        Entry e = heap_[i];
+        const int n = static_cast<int>(heap_.size());
+        while (true)
+        {
+            int first = 4 * i + 1;
+            if (first >= n)
+                break;
+            int best = first;
+            int last = first + 4 < n ? first + 4 : n;
+            for (int c = first + 1; c < last; ++c)
+                if (heap_[c].key < heap_[best].key)
+                    best = c;
+            if (!(heap_[best].key < e.key))
+                break;
+            heap_[i] = heap_[best];
+            pos_[heap_[i].id] = i;
+            i = best;
+        }
+        heap_[i] = e;
+        pos_[e.id] = i;
+    }
+
+    std::vector<Entry> heap_;
+    std::vector<int> pos_;
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <queue>
+#include <vector>
+
+#include "grid.h"
+#include "portals.h"
+
+// Jump Point Search for 4-connected grids where every passable cell is one
+// step. Of all equally short paths only the canonical ones are searched: they
+// step vertically as early as possible and leave a horizontal run only where
+// the cell beside it, one step back, is blocked (a forced neighbour). A
+// vertical run stops on every row whose horizontal scans find something, so
+// the open list holds just the turning points of those paths.
+//
+// With plus set, build() precomputes for every cell and direction how far the
+// next jump point or wall is (JPS+), and a jump becomes a table lookup plus a
+// check for the goal on the way. Tunnel mouths are always jump points.
+class JumpPointSearch
+{
+public:
+    void build(const Grid &grid, const PortalIndex *portals = nullptr, bool plus = false)
+    {
+        grid_ = &grid;
+        portals_ = portals != nullptr && !portals->empty() ? portals : nullptr;
+        S_ = grid.stride;
+        const int V = grid.size();
+        stamp_.assign(V, 0);
+        g_.assign(V, 0);
+        from_.assign(V, -1);
+        hop_.assign(V, 0);
+        round_ = 0;
+        mouth_dist_.clear();
+        if (portals_ != nullptr)
+            mouth_dist_ = mouthDistances(grid, *portals_);
+        plus_ = plus;
+        for (auto &t : jump_)
+            t.clear();
+        if (!plus)
+            return;
+        for (auto &t : jump_)
+            t.assign(V, 0);
+        // Horizontal tables first: a vertical run stops where they are positive.
+        fillTable(grid, 1);
+        fillTable(grid, 3);
+        fillTable(grid, 0);
+        fillTable(grid, 2);
+    }
+
+    // Step-optimal path from start_id to goal_id as cell ids, empty when the
+    // goal cannot be reached.
+    std::vector<int> path(int start_id, int goal_id)
+    {
+        struct Item
+        {
+            int f, g, id;
+            bool operator<(const Item &o) const { return f != o.f ? f > o.f : g < o.g; }
+        };
+        goal_ = goal_id;
+        ++round_;
+        opened_ = 0;
+        std::priority_queue<Item> open;
+        auto relax = [&](int v, int g, int from, bool hop)
+        {
+            if (stamp_[v] == round_ && g_[v] <= g)
+                return;
+            stamp_[v] = round_;
+            g_[v] = g;
+            from_[v] = from;
+            hop_[v] = hop;
+            opened_++;
+            open.push({g + heuristic(v), g, v});
+        };
+        relax(start_id, 0, -1, false);
+        while (!open.empty())
+        {
+            Item cur = open.top();
+            open.pop();
+            int u = cur.id;
+            if (cur.g != g_[u])
+                continue;
+            if (u == goal_)
+                break;
+            int dirs = directions(u);
+            for (int d = 0; d < 4; ++d)
+            {
+                if (!(dirs >> d & 1))
+                    continue;
+                int v = plus_ ? lookup(u, d) : scan(u, d);
+                if (v != -1)
+                    relax(v, cur.g + distance(u, v), u, false);
+            }
+            if (isMouth(u))
+                portals_->forEachExit(u, [&](int v)
+                {
+                    if (!blocked(v))
+                        relax(v, cur.g + 1, u, true);
+                });
+        }
+        std::vector<int> ids;
+        if (stamp_[goal_id] != round_)
+            return ids;
+        for (int cur = goal_id; cur != start_id;)
+        {
+            int p = from_[cur];
+            if (hop_[cur])
+                ids.push_back(cur);
+            else
+            {
+                int step = p / S_ == cur / S_ ? (cur > p ? -1 : 1) : (cur > p ? -S_ : S_);
+                for (int w = cur; w != p; w += step)
+                    ids.push_back(w);
+            }
+            cur = p;
+        }
+        ids.push_back(start_id);
+        std::reverse(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // Jump points put on the open list by the last path() call.
+    long long opened() const { return opened_; }
+
+private:
+    // Directions in forEachNeighbor order: up, left, down, right.
+    int stepOf(int d) const { return d == 0 ? -S_ : d == 1 ? -1 : d == 2 ? S_ : 1; }
+    bool blocked(int v) const { return (*grid_)[v] == 5; }
+    bool isMouth(int v) const { return portals_ != nullptr && portals_->isMouth(v); }
+
+    // Entering w horizontally by dx: does w have a vertical neighbour that the
+    // canonical order cannot reach from the cell behind it?
+    bool forced(int w, int dx) const
+    {
+        return (!blocked(w - S_) && blocked(w - dx - S_)) || (!blocked(w + S_) && blocked(w - dx + S_));
+    }
+
+    // Bit mask of directions to jump in from u, given how u was reached.
+    int directions(int u) const
+    {
+        int p = from_[u];
+        if (p == -1 || hop_[u] || isMouth(u))
+            return 15;
+        if (p / S_ != u / S_)
+            return (u > p ? 4 : 1) | 2 | 8;
+        int dx = u > p ? 1 : -1;
+        int mask = dx > 0 ? 8 : 2;
+        if (!blocked(u - S_) && blocked(u - dx - S_))
+            mask |= 1;
+        if (!blocked(u + S_) && blocked(u - dx + S_))
+            mask |= 4;
+        return mask;
+    }
+
+    int distance(int u, int v) const { return std::abs(u % S_ - v % S_) + std::abs(u / S_ - v / S_); }
+
+    // Manhattan distance to the goal, or to the nearest tunnel mouth if that
+    // is closer, which keeps it admissible when tunnels exist.
+    int heuristic(int v) const
+    {
+        int h = distance(v, goal_);
+        return mouth_dist_.empty() ? h : std::min(h, mouth_dist_[v]);
+    }
+
+    // Next jump point from u in direction d by walking the grid, -1 if none.
+    int scan(int u, int d) const
+    {
+        int step = stepOf(d);
+        for (int w = u + step;; w += step)
+        {
+            if (blocked(w))
+                return -1;
+            if (w == goal_ || isMouth(w))
+                return w;
+            if ((d & 1) ? forced(w, step) : (scan(w, 1) != -1 || scan(w, 3) != -1))
+                return w;
+        }
+    }
+
+    // jump_[d][u] is k > 0 when the k-th cell from u in direction d is a jump
+    // point, and -k when k free cells lead to a wall without one. Cells are
+    // filled so that u + step is always done before u.
+    void fillTable(const Grid &grid, int d)
+    {
+        int step = stepOf(d);
+        std::vector<int> &t = jump_[d];
+        for (int i = 0; i < grid.X * grid.Y; ++i)
+        {
+            int k = step > 0 ? grid.X * grid.Y - 1 - i : i;
+            int u = grid.id(k % grid.X, k / grid.X);
+            int next = u + step;
+            if (blocked(next))
+                t[u] = 0;
+            else if (isMouth(next) || ((d & 1) ? forced(next, step) : jump_[1][next] > 0 || jump_[3][next] > 0))
+                t[u] = 1;
+            else
+                t[u] = t[next] > 0 ? t[next] + 1 : t[next] - 1;
+        }
+    }
+
+    // Same result as scan() from the tables: the stored jump point, unless
+    // the goal, or for a vertical run the goal's row with a clear line to
+    // the goal, comes first.
+    int lookup(int u, int d) const
+    {
+        int t = jump_[d][u];
+        int reach = t > 0 ? t : -t;
+        int step = stepOf(d);
+        int ux = u % S_, uy = u / S_, gx = goal_ % S_, gy = goal_ / S_;
+        int sign = step > 0 ? 1 : -1;
+        if (d & 1)
+        {
+            int k = (gx - ux) * sign;
+            if (gy == uy && k >= 1 && k <= reach)
+                return goal_;
+        }
+        else
+        {
+            int k = (gy - uy) * sign;
+            if (k >= 1 && k <= reach)
+            {
+                int c = u + k * step;
+                if (k == t || c == goal_ || std::abs(gx - ux) <= -jump_[gx > ux ? 3 : 1][c])
+                    return c;
+            }
+        }
+        return t > 0 ? u + t * step : -1;
+    }
+
+    const Grid *grid_ = nullptr;
+    const PortalIndex *portals_ = nullptr;
+    int S_ = 0, goal_ = -1, round_ = 0;
+    bool plus_ = false;
+    long long opened_ = 0;
+    std::vector<int> stamp_, g_, from_;
+    std::vector<char> hop_;
+    std::vector<int> mouth_dist_;
+    std::vector<int> jump_[4];
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file; the OS pages it in as the parser walks it.
+// Files that are read in no particular order are opened with sequential off.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &path, std::string &error, bool sequential = true)
+    {
+        close();
+#ifdef _WIN32
+        file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | (sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS),
+                            nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+        {
+            error = path + ": cannot open file";
+            return false;
+        }
+        LARGE_INTEGER len;
+        if (!GetFileSizeEx(file_, &len))
+        {
+            error = path + ": cannot read file size";
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(len.QuadPart);
+        if (size_ == 0)
+            return true;
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr)
+        {
+            error = path + ": cannot map file";
+            close();
+            return false;
+        }
+        data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0)
+        {
+            error = path + ": cannot open file";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0)
+        {
+            error = path + ": cannot read file size";
+            close();
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0)
+            return true;
+        void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        data_ = (p == MAP_FAILED) ? nullptr : static_cast<const char *>(p);
+        if (data_ != nullptr)
+            madvise(p, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+        if (data_ == nullptr)
+        {
+            error = path + ": cannot map file";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (data_ != nullptr)
+            UnmapViewOfFile(data_);
+        if (mapping_ != nullptr)
+            CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE)
+            CloseHandle(file_);
+        mapping_ = nullptr;
+        file_ = INVALID_HANDLE_VALUE;
+#else
+        if (data_ != nullptr)
+            munmap(const_cast<char *>(data_), size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "grid.h"
+#include "portals.h"
+
+// Multi-source BFS: up to 64 searches share one level-synchronous sweep.
+// Every cell carries a 64-bit mask of the sources that have reached it, and a
+// level step pushes each frontier cell's new bits to its neighbours in one
+// AND/OR, so all sources advance together and each cell is touched once per
+// level however many sources reach it then.
+// On a grid, waves from scattered sources seldom reach a cell on the same
+// level, so a batch costs about as much as its single-source BFS runs; the
+// gain is that every pair comes out of one pass over the sources.
+//
+// DistanceMatrix runs it in batches of 64 over a list of points and keeps the
+// step distance between every pair (-1 when unreachable).
+class DistanceMatrix
+{
+public:
+    void build(const Grid &grid, const PortalIndex *portals, const std::vector<int> &points)
+    {
+        points_ = points;
+        const int K = static_cast<int>(points.size());
+        dist_.assign(static_cast<size_t>(K) * K, -1);
+        reached_ = 0;
+        std::vector<uint64_t> seen(grid.size()), next(grid.size());
+        std::vector<std::pair<int, uint64_t>> frontier;
+        std::vector<int> touched;
+        for (int first = 0; first < K; first += 64)
+        {
+            const int batch = K - first < 64 ? K - first : 64;
+            std::fill(seen.begin(), seen.end(), 0);
+            touched.clear();
+            known_.assign(K, 0);
+            long long missing = static_cast<long long>(batch) * K;
+            for (int b = 0; b < batch; ++b)
+            {
+                int u = points[first + b];
+                if (next[u] == 0)
+                    touched.push_back(u);
+                next[u] |= uint64_t(1) << b;
+            }
+            for (int d = 0; !touched.empty() && missing > 0; ++d)
+            {
+                frontier.clear();
+                for (int v : touched)
+                {
+                    seen[v] |= next[v];
+                    frontier.push_back({v, next[v]});
+                    next[v] = 0;
+                }
+                missing -= record(d, seen, first);
+                touched.clear();
+                for (auto &f : frontier)
+                {
+                    uint64_t bits = f.second;
+                    auto spread = [&](int v)
+                    {
+                        uint64_t fresh = bits & ~seen[v];
+                        if (fresh == 0)
+                            return;
+                        if (next[v] == 0)
+                            touched.push_back(v);
+                        next[v] |= fresh;
+                    };
+                    if (portals != nullptr)
+                        forEachNeighbor(grid, *portals, f.first, spread);
+                    else
+                        forEachNeighbor(grid, f.first, spread);
+                }
+            }
+            for (int v : touched)
+                next[v] = 0;
+            for (uint64_t s : seen)
+                reached_ += s != 0;
+        }
+    }
+
+    int size() const { return static_cast<int>(points_.size()); }
+    int point(int i) const { return points_[i]; }
+    // Steps from point i to point j, -1 when j cannot be reached from i.
+    int at(int i, int j) const { return dist_[static_cast<size_t>(i) * points_.size() + j]; }
+    // Cells swept, summed over the batches.
+    long long reached() const { return reached_; }
+
+private:
+    // Stores level d for every point whose seen mask gained sources this level.
+    int record(int d, const std::vector<uint64_t> &seen, int first)
+    {
+        int found = 0;
+        const size_t K = points_.size();
+        for (size_t j = 0; j < K; ++j)
+        {
+            uint64_t fresh = seen[points_[j]] & ~known_[j];
+            known_[j] |= fresh;
+            for (; fresh != 0; fresh &= fresh - 1)
+            {
+                dist_[(first + ctz64(fresh)) * K + j] = d;
+                ++found;
+            }
+        }
+        return found;
+    }
+
+    std::vector<int> points_;
+    std::vector<int> dist_;
+    std::vector<uint64_t> known_;
+    long long reached_ = 0;
+};
+
+// S, G, every Pokemon and every tunnel mouth, in that order, as cell ids, so
+// S is always point 0, G point 1 and Pokemon j point 2 + j (tour.h relies on
+// it). A missing S or G (-1) takes the programs' default, the top-left and
+// bottom-right cell.
+inline std::vector<int> pointsOfInterest(const Grid &grid, int start_id, int goal_id,
+                                         const std::vector<Coordinate> &pokemons,
+                                         const std::vector<Tunnel> &tunnels)
+{
+    std::vector<int> points;
+    points.push_back(start_id >= 0 ? start_id : grid.id(0, 0));
+    points.push_back(goal_id >= 0 ? goal_id : grid.id(grid.X - 1, grid.Y - 1));
+    for (auto &p : pokemons)
+        points.push_back(grid.id(p.x, p.y));
+    for (auto &t : tunnels)
+    {
+        points.push_back(grid.id(t.A.x, t.A.y));
+        points.push_back(grid.id(t.B.x, t.B.y));
+    }
+    return points;
+}
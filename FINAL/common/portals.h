@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "grid.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+inline int popcount64(uint64_t v) { return static_cast<int>(__popcnt64(v)); }
+inline int ctz64(uint64_t v)
+{
+    unsigned long i;
+    _BitScanForward64(&i, v);
+    return static_cast<int>(i);
+}
+#else
+inline int popcount64(uint64_t v) { return __builtin_popcountll(v); }
+inline int ctz64(uint64_t v) { return __builtin_ctzll(v); }
+#endif
+
+// Tunnel mouths as one flag bit per cell plus a compact exit table. The exits
+// of mouth u are exits[offset[r]] .. exits[offset[r + 1] - 1] where r is the
+// number of mouths before u, found from a per-word prefix count and one
+// popcount. The lookup cost does not depend on how many tunnels the map has.
+struct PortalIndex
+{
+    std::vector<uint64_t> mouth;
+    std::vector<int> rank;
+    std::vector<int> offset;
+    std::vector<int> exits;
+
+    void build(const Grid &grid, const std::vector<Tunnel> &tunnels)
+    {
+        int V = grid.size();
+        mouth.assign((V + 63) / 64, 0);
+        rank.assign(mouth.size(), 0);
+        std::vector<std::pair<int, int>> edges;
+        for (const Tunnel &t : tunnels)
+        {
+            int a = grid.id(t.A.x, t.A.y), b = grid.id(t.B.x, t.B.y);
+            edges.push_back({a, b});
+            if (a != b)
+                edges.push_back({b, a});
+            mouth[a >> 6] |= uint64_t(1) << (a & 63);
+            mouth[b >> 6] |= uint64_t(1) << (b & 63);
+        }
+        int count = 0;
+        for (size_t w = 0; w < mouth.size(); ++w)
+        {
+            rank[w] = count;
+            count += popcount64(mouth[w]);
+        }
+        offset.assign(count + 1, 0);
+        for (auto &e : edges)
+            offset[slot(e.first) + 1]++;
+        for (int r = 0; r < count; ++r)
+            offset[r + 1] += offset[r];
+        exits.assign(edges.size(), 0);
+        std::vector<int> next(offset.begin(), offset.end() - 1);
+        for (auto &e : edges)
+            exits[next[slot(e.first)]++] = e.second;
+    }
+
+    bool empty() const { return exits.empty(); }
+    bool isMouth(int v) const { return (mouth[v >> 6] >> (v & 63)) & 1; }
+    int slot(int v) const { return rank[v >> 6] + popcount64(mouth[v >> 6] & ((uint64_t(1) << (v & 63)) - 1)); }
+
+    template <typename Visit>
+    void forEachExit(int u, Visit visit) const
+    {
+        if (exits.empty() || !isMouth(u))
+            return;
+        int r = slot(u);
+        for (int i = offset[r]; i < offset[r + 1]; ++i)
+            visit(exits[i]);
+    }
+};
+
+// 4-connected neighbours of u followed by the passable exits of a tunnel mouth at u.
+template <typename Visit>
+inline void forEachNeighbor(const Grid &grid, const PortalIndex &portals, int u, Visit visit)
+{
+    forEachNeighbor(grid, u, visit);
+    portals.forEachExit(u, [&](int v)
+    {
+        if (grid[v] != 5)
+            visit(v);
+    });
+}
+
+// Manhattan distance from every cell to the nearest passable tunnel mouth,
+// ignoring obstacles, as a table over Grid ids: the L1 distance transform, one sweep
+// down and right and one back up and left. It turns the tunnel term of a
+// heuristic into one lookup however many tunnels there are. Empty when the
+// map has no tunnels.
+inline std::vector<int> mouthDistances(const Grid &grid, const PortalIndex &portals)
+{
+    std::vector<int> d;
+    if (portals.empty())
+        return d;
+    const int S = grid.stride, H = grid.Y + 2, V = grid.size();
+    d.assign(V, INT_MAX / 2);
+    for (int v = 0; v < V; ++v)
+        if (portals.isMouth(v) && grid[v] != 5)
+            d[v] = 0;
+    for (int y = 0; y < H; ++y)
+        for (int x = 0; x < S; ++x)
+        {
+            int v = y * S + x;
+            if (x > 0)
+                d[v] = std::min(d[v], d[v - 1] + 1);
+            if (y > 0)
+                d[v] = std::min(d[v], d[v - S] + 1);
+        }
+    for (int y = H - 1; y >= 0; --y)
+        for (int x = S - 1; x >= 0; --x)
+        {
+            int v = y * S + x;
+            if (x + 1 < S)
+                d[v] = std::min(d[v], d[v + 1] + 1);
+            if (y + 1 < H)
+                d[v] = std::min(d[v], d[v + S] + 1);
+        }
+    return d;
+}
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <limits>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "bucket_queue.h"
+#include "grid.h"
+#include "heuristics.h"
+#include "portals.h"
+
+// The search loop shared by bfs(), ucs() and astar(). bestFirstSearch() is a
+// template on four policies, so each program gets its own fully specialized
+// inner loop with no indirect calls:
+//   OpenList   push(f, g, id) and pop() -> entry with .id; the order of the
+//              pops is the only thing that tells BFS, Dijkstra and A* apart.
+//              LABEL_ONCE = true promises no cell is pushed twice
+//   Edges      edges(u, visit) calls visit(v) for every cell v reachable
+//              from u in one step
+//   Cost       cost(t) is the cost of entering a cell of terrain t; values of
+//              INT_MAX or more mark impassable terrain. Path costs are kept
+//              in the type cost() returns
+//   Heuristic  h(v) estimates the cost from v to the goal (heuristics.h);
+//              NO_BOUND counts as 0
+// A cell is labelled the first time it gets a finite g and closed when it
+// is popped. An improved g reopens a closed cell, so inconsistent
+// heuristics still give the cheapest path; pops of cells already closed are
+// stale entries and are skipped.
+
+// Breadth-first order: f and g are ignored. Meant for UnitCost, where each
+// cell is labelled once, by the first cell that reaches it, and never goes
+// stale; the search then keeps no closed flags.
+class FifoOpenList
+{
+public:
+    static constexpr bool LABEL_ONCE = true;
+
+    struct Entry
+    {
+        int id;
+    };
+
+    bool empty() const { return q_.empty(); }
+    void push(long long, long long, int id) { q_.push(id); }
+    Entry pop()
+    {
+        int id = q_.front();
+        q_.pop();
+        return {id};
+    }
+
+private:
+    std::queue<int> q_;
+};
+
+// Dial's algorithm: a BucketQueue keyed on f. Needs monotone integer f with
+// steps of at most max_step, i.e. uniform-cost search with ZeroHeuristic.
+class BucketOpenList
+{
+public:
+    struct Entry
+    {
+        long long f;
+        int id;
+    };
+
+    explicit BucketOpenList(int max_step) : q_(max_step) {}
+
+    bool empty() const { return q_.empty(); }
+    void push(long long f, long long, int id) { q_.push(id, f); }
+    Entry pop()
+    {
+        long long f;
+        int id = q_.pop(f);
+        return {f, id};
+    }
+
+private:
+    BucketQueue q_;
+};
+
+// Binary heap on f alone, for uniform-cost search.
+class HeapOpenList
+{
+public:
+    struct Entry
+    {
+        long long f;
+        int id;
+        bool operator<(const Entry &other) const { return f > other.f; }
+    };
+
+    bool empty() const { return q_.empty(); }
+    void push(long long f, long long, int id) { q_.push({f, id}); }
+    Entry pop()
+    {
+        Entry top = q_.top();
+        q_.pop();
+        return top;
+    }
+
+private:
+    std::priority_queue<Entry> q_;
+};
+
+// Binary heap for A*: smallest f first, ties to the largest g, the same
+// order as FgBucketQueue. Its entries are half again as wide as those of
+// HeapOpenList, which slows a plain Dijkstra run by about 40%.
+class FgHeapOpenList
+{
+public:
+    struct Entry
+    {
+        long long f;
+        long long g;
+        int id;
+        bool operator<(const Entry &other) const
+        {
+            if (f != other.f)
+                return f > other.f;
+            return g < other.g;
+        }
+    };
+
+    bool empty() const { return q_.empty(); }
+    void push(long long f, long long g, int id) { q_.push({f, g, id}); }
+    Entry pop()
+    {
+        Entry top = q_.top();
+        q_.pop();
+        return top;
+    }
+
+private:
+    std::priority_queue<Entry> q_;
+};
+
+// Four neighbours on the grid.
+struct GridEdges
+{
+    const Grid &grid;
+
+    template <typename Visit>
+    void operator()(int u, Visit visit) const { forEachNeighbor(grid, u, visit); }
+};
+
+// Four neighbours plus the tunnel exits of u.
+struct PortalEdges
+{
+    const Grid &grid;
+    const PortalIndex &portals;
+
+    template <typename Visit>
+    void operator()(int u, Visit visit) const { forEachNeighbor(grid, portals, u, visit); }
+};
+
+// Every step costs 1: BFS.
+struct UnitCost
+{
+    int operator()(int) const { return 1; }
+};
+
+struct SearchResult
+{
+    std::vector<int> path;  // cell ids from start to goal, empty if unreachable
+    long long cost = -1;    // cost of path, -1 if unreachable
+    long long labelled = 0; // cells that got a finite g, start included
+    long long closed = 0;   // cells popped and expanded, each counted once
+    long long stale = 0;    // pops of cells that were already closed
+};
+
+// OpenList::LABEL_ONCE, false for open lists that do not declare it, such as
+// FgBucketQueue.
+template <typename OpenList, typename = void>
+struct LabelsOnce : std::false_type
+{
+};
+template <typename OpenList>
+struct LabelsOnce<OpenList, std::void_t<decltype(OpenList::LABEL_ONCE)>> : std::bool_constant<OpenList::LABEL_ONCE>
+{
+};
+
+// Goal tests for bestFirstSearch(). When a cell u is closed with cost d the
+// search asks done(u, d) whether to stop before expanding it; target() then
+// names the cell whose path is returned, -1 for none.
+
+// One goal cell.
+class SingleTarget
+{
+public:
+    explicit SingleTarget(int goal_id) : goal_(goal_id) {}
+    bool operator()(int u, long long) const { return u == goal_; }
+    int target() const { return goal_; }
+
+private:
+    int goal_;
+};
+
+// The cheapest of several targets, ties to the lowest rank: rank[v] >= 0
+// marks v as a target. Needs cells closed in cost order (no heuristic), and
+// runs on until a cell costlier than the first target found is closed, so
+// every target tied with it has been seen.
+class NearestTarget
+{
+public:
+    explicit NearestTarget(const std::vector<int> &rank) : rank_(&rank) {}
+    bool operator()(int u, long long d)
+    {
+        if (best_ != -1 && d > best_cost_)
+            return true;
+        if ((*rank_)[u] >= 0 && (best_ == -1 || (*rank_)[u] < (*rank_)[best_]))
+        {
+            best_ = u;
+            best_cost_ = d;
+        }
+        return false;
+    }
+    int target() const { return best_; }
+
+private:
+    const std::vector<int> *rank_;
+    int best_ = -1;
+    long long best_cost_ = 0;
+};
+
+// Every cell of a set: stops once all of them are closed and keeps their
+// costs. slot[v] >= 0 numbers the count distinct cells of the set.
+class AllTargets
+{
+public:
+    AllTargets(const std::vector<int> &slot, int count) : slot_(&slot), cost_(count, -1), left_(count) {}
+    bool operator()(int u, long long d)
+    {
+        int i = (*slot_)[u];
+        if (i >= 0 && cost_[i] < 0)
+        {
+            cost_[i] = d;
+            --left_;
+        }
+        return left_ == 0;
+    }
+    int target() const { return -1; }
+    long long cost(int i) const { return cost_[i]; }
+
+private:
+    const std::vector<int> *slot_;
+    std::vector<long long> cost_;
+    int left_;
+};
+
+// Searches from start_id until done says so or the open list runs dry, and
+// returns the path to done.target().
+template <typename OpenList, typename Goal, typename Edges, typename Cost, typename Heuristic = ZeroHeuristic>
+SearchResult bestFirstSearchUntil(const Grid &grid, int start_id, Goal &done, Edges edges, Cost cost,
+                                  Heuristic heuristic = Heuristic(), OpenList open = OpenList())
+{
+    using Distance = decltype(cost(0));
+    constexpr Distance UNREACHED = std::numeric_limits<Distance>::max();
+    constexpr bool label_once = LabelsOnce<OpenList>::value;
+    const int V = grid.size();
+    std::vector<Distance> g(V, UNREACHED);
+    std::vector<int> from(V, -1);
+    std::vector<char> closed(label_once ? 0 : V, 0);
+    SearchResult result;
+    auto estimate = [&](int v)
+    {
+        long long h = heuristic(v);
+        return h == NO_BOUND ? 0 : h;
+    };
+    g[start_id] = 0;
+    result.labelled++;
+    open.push(estimate(start_id), 0, start_id);
+    while (!open.empty())
+    {
+        int u = open.pop().id;
+        if constexpr (!label_once)
+        {
+            if (closed[u])
+            {
+                result.stale++;
+                continue;
+            }
+            closed[u] = 1;
+        }
+        result.closed++;
+        if (done(u, g[u]))
+            break;
+        edges(u, [&](int v)
+        {
+            Distance w = cost(grid[v]);
+            if (w >= INT_MAX)
+                return;
+            Distance tentative = g[u] + w;
+            if (tentative >= g[v])
+                return;
+            if (g[v] == UNREACHED)
+                result.labelled++;
+            from[v] = u;
+            g[v] = tentative;
+            if constexpr (!label_once)
+                closed[v] = 0;
+            open.push(tentative + estimate(v), tentative, v);
+        });
+    }
+    int goal_id = done.target();
+    if (goal_id != -1 && (from[goal_id] != -1 || start_id == goal_id))
+    {
+        for (int cur = goal_id; cur != -1; cur = from[cur])
+            result.path.push_back(cur);
+        std::reverse(result.path.begin(), result.path.end());
+        result.cost = g[goal_id];
+    }
+    return result;
+}
+
+// Searches from start_id until goal_id is popped or the open list runs dry.
+template <typename OpenList, typename Edges, typename Cost, typename Heuristic = ZeroHeuristic>
+SearchResult bestFirstSearch(const Grid &grid, int start_id, int goal_id, Edges edges, Cost cost,
+                             Heuristic heuristic = Heuristic(), OpenList open = OpenList())
+{
+    SingleTarget done(goal_id);
+    return bestFirstSearchUntil(grid, start_id, done, edges, cost, heuristic, open);
+}
+
+// Cheapest costs between every pair of a list of points, one search per
+// point that stops once all the others are closed, spread over threads. The
+// weighted counterpart of DistanceMatrix (ms_bfs.h).
+class CostMatrix
+{
+public:
+    template <typename OpenList, typename Edges, typename Cost>
+    void build(const Grid &grid, const std::vector<int> &points, Edges edges, Cost cost, OpenList open = OpenList())
+    {
+        const int K = static_cast<int>(points.size());
+        points_ = points;
+        cost_.assign(static_cast<size_t>(K) * K, -1);
+        closed_ = 0;
+        std::vector<int> slot(grid.size(), -1), slot_of(K);
+        int count = 0;
+        for (int i = 0; i < K; ++i)
+        {
+            if (slot[points[i]] == -1)
+                slot[points[i]] = count++;
+            slot_of[i] = slot[points[i]];
+        }
+        std::vector<long long> closed(K, 0);
+        std::atomic<int> next{0};
+        auto work = [&]()
+        {
+            for (int i; (i = next++) < K;)
+            {
+                AllTargets done(slot, count);
+                closed[i] = bestFirstSearchUntil(grid, points[i], done, edges, cost, ZeroHeuristic(), open).closed;
+                for (int j = 0; j < K; ++j)
+                    cost_[static_cast<size_t>(i) * K + j] = done.cost(slot_of[j]);
+            }
+        };
+        int threads = std::min<int>(K, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t)
+            workers.emplace_back(work);
+        work();
+        for (auto &w : workers)
+            w.join();
+        for (long long c : closed)
+            closed_ += c;
+    }
+
+    int size() const { return static_cast<int>(points_.size()); }
+    int point(int i) const { return points_[i]; }
+    // Cost from point i to point j, -1 when j cannot be reached from i.
+    long long at(int i, int j) const { return cost_[static_cast<size_t>(i) * points_.size() + j]; }
+    // Cells closed, summed over the searches.
+    long long closed() const { return closed_; }
+
+private:
+    std::vector<int> points_;
+    std::vector<long long> cost_;
+    long long closed_ = 0;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Out-of-core storage for maps and search workspaces that do not fit in RAM.
+// Cell ids are 64-bit (id = y * width + x); cells are grouped in square tiles
+// and only a bounded number of tiles is resident at a time.
+constexpr int TILE_SHIFT = 6;
+constexpr int64_t TILE_SIDE = int64_t(1) << TILE_SHIFT;
+constexpr int64_t TILE_CELLS = TILE_SIDE * TILE_SIDE;
+
+inline bool seekFile64(FILE *f, int64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(f, offset, SEEK_SET) == 0;
+#else
+    return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+// width x height array of trivially copyable T kept in TILE_SIDE x TILE_SIDE
+// tiles under an LRU byte budget. A tile touched for the first time is filled
+// by the loader; a dirty tile that gets evicted is spilled to an anonymous
+// scratch file and read back from there on its next use.
+template <typename T>
+class TileStore
+{
+public:
+    using Loader = std::function<void(int64_t tx, int64_t ty, T *tile)>;
+
+    TileStore() = default;
+    TileStore(const TileStore &) = delete;
+    TileStore &operator=(const TileStore &) = delete;
+    ~TileStore()
+    {
+        if (scratch_ != nullptr)
+            fclose(scratch_);
+    }
+
+    void init(int64_t width, int64_t height, size_t memory_limit, Loader loader)
+    {
+        width_ = width;
+        height_ = height;
+        tiles_x_ = (width + TILE_SIDE - 1) >> TILE_SHIFT;
+        max_slots_ = std::max<size_t>(4, memory_limit / (sizeof(T) * TILE_CELLS));
+        loader_ = std::move(loader);
+        slots_.clear();
+        resident_.clear();
+        spilled_.clear();
+        head_ = tail_ = -1;
+        last_tile_ = -1;
+        last_data_ = nullptr;
+        last_dirty_ = nullptr;
+    }
+
+    int64_t width() const { return width_; }
+    int64_t height() const { return height_; }
+
+    T get(int64_t x, int64_t y) { return tile(x, y)[offset(x, y)]; }
+    void set(int64_t x, int64_t y, const T &value)
+    {
+        T *t = tile(x, y);
+        *last_dirty_ = true;
+        t[offset(x, y)] = value;
+    }
+
+    long long tileLoads() const { return loads_; }
+    long long tileSpills() const { return spills_; }
+    size_t residentBytes() const { return slots_.size() * TILE_CELLS * sizeof(T); }
+
+private:
+    struct Slot
+    {
+        int64_t tile;
+        bool dirty;
+        int prev, next;
+        std::vector<T> data;
+    };
+
+    static int64_t offset(int64_t x, int64_t y) { return ((y & (TILE_SIDE - 1)) << TILE_SHIFT) | (x & (TILE_SIDE - 1)); }
+
+    T *tile(int64_t x, int64_t y)
+    {
+        int64_t t = (y >> TILE_SHIFT) * tiles_x_ + (x >> TILE_SHIFT);
+        if (t == last_tile_)
+            return last_data_;
+        int s;
+        auto it = resident_.find(t);
+        if (it != resident_.end())
+        {
+            s = it->second;
+            unlink(s);
+        }
+        else
+            s = bring(t);
+        pushFront(s);
+        last_tile_ = t;
+        last_data_ = slots_[s].data.data();
+        last_dirty_ = &slots_[s].dirty;
+        return last_data_;
+    }
+
+    int bring(int64_t t)
+    {
+        int s;
+        if (slots_.size() < max_slots_)
+        {
+            s = static_cast<int>(slots_.size());
+            slots_.push_back({-1, false, -1, -1, std::vector<T>(TILE_CELLS)});
+        }
+        else
+        {
+            s = tail_;
+            unlink(s);
+            Slot &old = slots_[s];
+            if (old.dirty)
+                spill(old);
+            resident_.erase(old.tile);
+        }
+        Slot &slot = slots_[s];
+        slot.tile = t;
+        slot.dirty = false;
+        if (spilled_.count(t))
+        {
+            seekFile64(scratch_, t * TILE_CELLS * static_cast<int64_t>(sizeof(T)));
+            if (fread(slot.data.data(), sizeof(T), TILE_CELLS, scratch_) != static_cast<size_t>(TILE_CELLS))
+                throw std::runtime_error("tile scratch file read failed");
+        }
+        else
+            loader_(t % tiles_x_, t / tiles_x_, slot.data.data());
+        resident_[t] = s;
+        loads_++;
+        return s;
+    }
+
+    void spill(Slot &slot)
+    {
+        if (scratch_ == nullptr)
+            scratch_ = tmpfile();
+        if (scratch_ == nullptr || !seekFile64(scratch_, slot.tile * TILE_CELLS * static_cast<int64_t>(sizeof(T))) ||
+            fwrite(slot.data.data(), sizeof(T), TILE_CELLS, scratch_) != static_cast<size_t>(TILE_CELLS))
+            throw std::runtime_error("tile scratch file write failed");
+        spilled_.insert(slot.tile);
+        spills_++;
+    }
+
+    void unlink(int s)
+    {
+        Slot &slot = slots_[s];
+        if (slot.prev != -1)
+            slots_[slot.prev].next = slot.next;
+        else
+            head_ = slot.next;
+        if (slot.next != -1)
+            slots_[slot.next].prev = slot.prev;
+        else
+            tail_ = slot.prev;
+        slot.prev = slot.next = -1;
+    }
+
+    void pushFront(int s)
+    {
+        slots_[s].next = head_;
+        if (head_ != -1)
+            slots_[head_].prev = s;
+        head_ = s;
+        if (tail_ == -1)
+            tail_ = s;
+    }
+
+    int64_t width_ = 0, height_ = 0, tiles_x_ = 0;
+    size_t max_slots_ = 0;
+    Loader loader_;
+    std::vector<Slot> slots_;
+    std::unordered_map<int64_t, int> resident_;
+    std::unordered_set<int64_t> spilled_;
+    int head_ = -1, tail_ = -1;
+    int64_t last_tile_ = -1;
+    T *last_data_ = nullptr;
+    bool *last_dirty_ = nullptr;
+    FILE *scratch_ = nullptr;
+    long long loads_ = 0, spills_ = 0;
+};
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <climits>
+#include <cmath>
+#include <deque>
+#include <queue>
+#include <unordered_map>
+
+#include "grid_bin.h"
+#include "tiled.h"
+
+// BFS, UCS and A* over a binary map whose terrain and search state are paged
+// through TileStores, so the grid and the per-cell workspaces never have to
+// fit in memory. Only the open list and the final path are kept in RAM.
+// Costs come from the caller as in bestFirstSearch() (search.h): cost(t) is
+// the cost of entering a cell of terrain t, values of INT_MAX or more mark
+// impassable terrain and terrain 5 always is. BFS only uses it to weigh the
+// path it finds.
+
+template <typename Cost>
+inline long long tiledStepCost(Cost cost, uint8_t cell)
+{
+    long long w = cell == 5 ? INT_MAX : static_cast<long long>(cost(cell));
+    return w >= INT_MAX ? -1 : w;
+}
+
+struct TiledMap
+{
+    int64_t X = 0, Y = 0;
+    int64_t start_id = -1, goal_id = -1;
+    std::vector<Coordinate> pokemons;
+    std::vector<Tunnel> tunnels;
+    std::unordered_multimap<int64_t, int64_t> portals;
+    TileStore<uint8_t> terrain;
+
+    TiledMap() = default;
+    TiledMap(const TiledMap &) = delete;
+    TiledMap &operator=(const TiledMap &) = delete;
+    ~TiledMap()
+    {
+        if (file_ != nullptr)
+            fclose(file_);
+    }
+
+    int64_t id(int64_t x, int64_t y) const { return y * X + x; }
+    Coordinate coord(int64_t id) const { return {static_cast<int>(id % X), static_cast<int>(id / X)}; }
+    uint8_t at(int64_t id) { return terrain.get(id % X, id / X); }
+
+    bool open(const std::string &filename, size_t memory_limit, std::string &error)
+    {
+        file_ = fopen(filename.c_str(), "rb");
+        GridBinHeader h;
+        if (file_ == nullptr || fread(&h, sizeof(h), 1, file_) != 1 || !isGridBinary(h.magic, sizeof(h.magic)))
+        {
+            error = filename + ": not a binary grid file";
+            return false;
+        }
+        if (h.version != GRID_BIN_VERSION || h.header_size != sizeof(GridBinHeader) || h.width <= 0 || h.height <= 0)
+        {
+            error = filename + ": unsupported or corrupt binary grid";
+            return false;
+        }
+        X = h.width;
+        Y = h.height;
+        auto inside = [this](int32_t x, int32_t y) { return x >= 0 && y >= 0 && x < X && y < Y; };
+        auto absent = [](int32_t x, int32_t y) { return x == -1 && y == -1; };
+        if (!(absent(h.start_x, h.start_y) || inside(h.start_x, h.start_y)) ||
+            !(absent(h.goal_x, h.goal_y) || inside(h.goal_x, h.goal_y)))
+        {
+            error = filename + ": start or goal outside the grid";
+            return false;
+        }
+        start_id = h.start_x < 0 ? -1 : id(h.start_x, h.start_y);
+        goal_id = h.goal_x < 0 ? -1 : id(h.goal_x, h.goal_y);
+        std::vector<int32_t> ints(2 * h.pokemon_count + 4 * h.tunnel_count);
+        if (!seekFile64(file_, static_cast<int64_t>(h.pokemon_offset)) ||
+            fread(ints.data(), sizeof(int32_t), ints.size(), file_) != ints.size())
+        {
+            error = filename + ": truncated binary grid";
+            return false;
+        }
+        for (size_t i = 0; i < ints.size(); i += 2)
+            if (!inside(ints[i], ints[i + 1]))
+            {
+                error = filename + (i < 2 * h.pokemon_count ? ": Pokemon outside the grid"
+                                                             : ": tunnel endpoint outside the grid");
+                return false;
+            }
+        for (uint32_t i = 0; i < h.pokemon_count; ++i)
+            pokemons.push_back({ints[2 * i], ints[2 * i + 1]});
+        const int32_t *tn = ints.data() + 2 * h.pokemon_count;
+        for (uint32_t i = 0; i < h.tunnel_count; ++i)
+        {
+            Tunnel t = {{tn[4 * i], tn[4 * i + 1]}, {tn[4 * i + 2], tn[4 * i + 3]}};
+            tunnels.push_back(t);
+            portals.insert({id(t.A.x, t.A.y), id(t.B.x, t.B.y)});
+            portals.insert({id(t.B.x, t.B.y), id(t.A.x, t.A.y)});
+        }
+        terrain_offset_ = static_cast<int64_t>(h.terrain_offset);
+        terrain.init(X, Y, memory_limit, [this](int64_t tx, int64_t ty, uint8_t *tile)
+                     { loadTile(tx, ty, tile); });
+        return true;
+    }
+
+private:
+    // Tiles are cut from the row-major terrain one row strip at a time, skipping
+    // the file's obstacle border; cells past the map edge read as obstacles.
+    void loadTile(int64_t tx, int64_t ty, uint8_t *tile)
+    {
+        std::fill(tile, tile + TILE_CELLS, uint8_t(5));
+        int64_t x0 = tx * TILE_SIDE, y0 = ty * TILE_SIDE;
+        int64_t w = std::min(TILE_SIDE, X - x0);
+        for (int64_t r = 0; r < TILE_SIDE && y0 + r < Y; ++r)
+        {
+            if (!seekFile64(file_, terrain_offset_ + (y0 + r + 1) * (X + 2) + x0 + 1) ||
+                fread(tile + r * TILE_SIDE, 1, static_cast<size_t>(w), file_) != static_cast<size_t>(w))
+                throw std::runtime_error("binary grid terrain read failed");
+        }
+    }
+
+    FILE *file_ = nullptr;
+    int64_t terrain_offset_ = 0;
+};
+
+struct TiledSearchResult
+{
+    std::vector<Coordinate> path;
+    long long nodes_opened = 0;
+    long long weight = 0;
+    long long tile_loads = 0, tile_spills = 0;
+};
+
+template <typename Visit>
+inline void forEachTiledNeighbor(TiledMap &map, int64_t u, Visit visit)
+{
+    int64_t x = u % map.X, y = u / map.X;
+    if (y > 0)
+        visit(u - map.X);
+    if (x > 0)
+        visit(u - 1);
+    if (y + 1 < map.Y)
+        visit(u + map.X);
+    if (x + 1 < map.X)
+        visit(u + 1);
+    if (!map.portals.empty())
+    {
+        auto range = map.portals.equal_range(u);
+        for (auto it = range.first; it != range.second; ++it)
+            visit(it->second);
+    }
+}
+
+template <typename Parent, typename Cost>
+inline void tracePath(TiledMap &map, int64_t start_id, int64_t goal_id, Parent parent, Cost cost,
+                      TiledSearchResult &result)
+{
+    for (int64_t cur = goal_id;; cur = parent(cur))
+    {
+        result.path.push_back(map.coord(cur));
+        if (cur == start_id)
+            break;
+        result.weight += std::max(0LL, tiledStepCost(cost, map.at(cur)));
+    }
+    std::reverse(result.path.begin(), result.path.end());
+}
+
+// Unweighted BFS; the parent of every discovered cell lives in a tiled workspace.
+template <typename Cost>
+inline TiledSearchResult tiledBfs(TiledMap &map, int64_t start_id, int64_t goal_id, size_t memory_limit, Cost cost)
+{
+    TiledSearchResult result;
+    TileStore<int64_t> from;
+    from.init(map.X, map.Y, memory_limit, [](int64_t, int64_t, int64_t *tile)
+              { std::fill(tile, tile + TILE_CELLS, int64_t(-1)); });
+    auto parent = [&](int64_t v)
+    { return from.get(v % map.X, v / map.X); };
+    std::deque<int64_t> q;
+    q.push_back(start_id);
+    from.set(start_id % map.X, start_id / map.X, start_id);
+    result.nodes_opened++;
+    while (!q.empty())
+    {
+        int64_t u = q.front();
+        q.pop_front();
+        if (u == goal_id)
+            break;
+        forEachTiledNeighbor(map, u, [&](int64_t v)
+                             {
+            if (map.at(v) == 5 || parent(v) != -1)
+                return;
+            from.set(v % map.X, v / map.X, u);
+            result.nodes_opened++;
+            q.push_back(v); });
+    }
+    if (parent(goal_id) != -1)
+        tracePath(map, start_id, goal_id, parent, cost, result);
+    result.tile_loads = map.terrain.tileLoads() + from.tileLoads();
+    result.tile_spills = from.tileSpills();
+    return result;
+}
+
+// Best-first search on cost(t) weights (cost of the entered cell). With a
+// zero heuristic this is UCS, otherwise A* with the same f / larger-g order
+// as astar().
+template <typename Cost, typename Heuristic>
+inline TiledSearchResult tiledBestFirst(TiledMap &map, int64_t start_id, int64_t goal_id, size_t memory_limit,
+                                        Cost cost, Heuristic heuristic)
+{
+    struct Cell
+    {
+        long long g;
+        int64_t from;
+    };
+    struct Item
+    {
+        long long f, g;
+        int64_t id;
+        bool operator<(const Item &o) const { return f != o.f ? f > o.f : g < o.g; }
+    };
+    const long long INF = LLONG_MAX / 4;
+    TiledSearchResult result;
+    TileStore<Cell> cells;
+    cells.init(map.X, map.Y, memory_limit, [INF](int64_t, int64_t, Cell *tile)
+               { std::fill(tile, tile + TILE_CELLS, Cell{INF, -1}); });
+    auto cell = [&](int64_t v)
+    { return cells.get(v % map.X, v / map.X); };
+    std::priority_queue<Item> open;
+    cells.set(start_id % map.X, start_id / map.X, {0, start_id});
+    open.push({heuristic(start_id), 0, start_id});
+    while (!open.empty())
+    {
+        Item cur = open.top();
+        open.pop();
+        if (cur.g != cell(cur.id).g)
+            continue;
+        result.nodes_opened++;
+        if (cur.id == goal_id)
+            break;
+        forEachTiledNeighbor(map, cur.id, [&](int64_t v)
+                             {
+            long long w = tiledStepCost(cost, map.at(v));
+            if (w < 0)
+                return;
+            long long ng = cur.g + w;
+            if (ng < cell(v).g)
+            {
+                cells.set(v % map.X, v / map.X, {ng, cur.id});
+                open.push({ng + heuristic(v), ng, v});
+            } });
+    }
+    if (cell(goal_id).g < INF)
+        tracePath(map, start_id, goal_id, [&](int64_t v)
+                  { return cell(v).from; }, cost, result);
+    result.tile_loads = map.terrain.tileLoads() + cells.tileLoads();
+    result.tile_spills = cells.tileSpills();
+    return result;
+}
+
+template <typename Cost>
+inline TiledSearchResult tiledUcs(TiledMap &map, int64_t start_id, int64_t goal_id, size_t memory_limit, Cost cost)
+{
+    return tiledBestFirst(map, start_id, goal_id, memory_limit, cost, [](int64_t)
+                          { return 0LL; });
+}
+
+// Tunnel mouths bucketed on a coarse grid of about one mouth per bucket. The
+// nearest mouth to a cell is found by searching rings of buckets outwards
+// until a ring lies farther away than the best mouth so far, so the cost of
+// a query hardly depends on how many tunnels the map has. Memory is O(mouths),
+// unlike a per-cell table, which would not fit beside an out-of-core map.
+class MouthBuckets
+{
+public:
+    void build(int64_t X, int64_t Y, const std::vector<Coordinate> &mouths)
+    {
+        double area = double(X) * double(Y) / double(std::max<size_t>(1, mouths.size()));
+        side_ = std::max<int64_t>(1, static_cast<int64_t>(std::sqrt(area)));
+        nx_ = (X + side_ - 1) / side_;
+        ny_ = (Y + side_ - 1) / side_;
+        first_.assign(static_cast<size_t>(nx_ * ny_ + 1), 0);
+        for (auto &m : mouths)
+            first_[bucket(m) + 1]++;
+        for (size_t b = 1; b < first_.size(); ++b)
+            first_[b] += first_[b - 1];
+        points_.resize(mouths.size());
+        std::vector<size_t> next(first_.begin(), first_.end() - 1);
+        for (auto &m : mouths)
+            points_[next[bucket(m)]++] = m;
+    }
+
+    bool empty() const { return points_.empty(); }
+
+    // Euclidean distance from c to the nearest mouth; empty() must be false.
+    double nearest(Coordinate c) const
+    {
+        const int64_t bx = c.x / side_, by = c.y / side_;
+        double best = HUGE_VAL;
+        for (int64_t r = 0; r <= std::max(nx_, ny_); ++r)
+        {
+            // Every cell of ring r is at least (r - 1) * side_ + 1 away.
+            if (r > 0 && double((r - 1) * side_ + 1) > best)
+                break;
+            for (int64_t y = by - r; y <= by + r; ++y)
+            {
+                if (y < 0 || y >= ny_)
+                    continue;
+                int64_t step = (y == by - r || y == by + r) ? 1 : 2 * r;
+                for (int64_t x = bx - r; x <= bx + r; x += step)
+                {
+                    if (x < 0 || x >= nx_)
+                        continue;
+                    size_t b = static_cast<size_t>(y * nx_ + x);
+                    for (size_t k = first_[b]; k < first_[b + 1]; ++k)
+                    {
+                        double dx = double(c.x) - points_[k].x, dy = double(c.y) - points_[k].y;
+                        best = std::min(best, std::sqrt(dx * dx + dy * dy));
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+private:
+    size_t bucket(Coordinate m) const { return static_cast<size_t>(m.y / side_ * nx_ + m.x / side_); }
+
+    int64_t side_ = 1, nx_ = 0, ny_ = 0;
+    std::vector<size_t> first_;
+    std::vector<Coordinate> points_;
+};
+
+// A* with the Euclidean heuristic scaled by the cheapest terrain cost.
+// With tunnels the bound is also taken to the nearest tunnel mouth, which
+// keeps it admissible and consistent.
+template <typename Cost>
+inline TiledSearchResult tiledAstar(TiledMap &map, int64_t start_id, int64_t goal_id, size_t memory_limit, Cost cost)
+{
+    long long unit = LLONG_MAX;
+    for (int t = 0; t < 256; ++t)
+        if (tiledStepCost(cost, static_cast<uint8_t>(t)) >= 0)
+            unit = std::min(unit, tiledStepCost(cost, static_cast<uint8_t>(t)));
+    if (unit == LLONG_MAX || unit <= 0)
+        unit = 1;
+    std::vector<Coordinate> mouths;
+    for (auto &t : map.tunnels)
+    {
+        mouths.push_back(t.A);
+        mouths.push_back(t.B);
+    }
+    MouthBuckets buckets;
+    buckets.build(map.X, map.Y, mouths);
+    Coordinate goal = map.coord(goal_id);
+    return tiledBestFirst(map, start_id, goal_id, memory_limit, cost, [&](int64_t v)
+                          {
+        Coordinate c = map.coord(v);
+        double dx = double(c.x) - goal.x, dy = double(c.y) - goal.y;
+        double d = std::sqrt(dx * dx + dy * dy);
+        if (!buckets.empty())
+            d = std::min(d, buckets.nearest(c));
+        return static_cast<long long>(std::ceil(d)) * unit; });
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "portals.h"
+
+// Visiting orders for the Pokemon tour S -> every Pokemon -> G. The costs
+// between the stops come as dist(i, j) over the points of pointsOfInterest()
+// (ms_bfs.h): 0 is S, 1 is G and 2 + j is Pokemon j; a negative value means
+// j cannot be reached from i. Pokemon that S cannot reach are left out of the
+// order, and when G cannot be reached the tour simply ends at the last
+// Pokemon.
+
+// Held-Karp keeps a cost for every subset of Pokemon and every last Pokemon:
+// 2^K * K values, 168 MB at this limit.
+constexpr int HELD_KARP_MAX = 20;
+
+// Cheapest order, by Held-Karp bitmask DP. dp[mask][j] is the cheapest walk
+// from S through the Pokemon in mask that ends at j; it only reads subsets
+// one smaller, so the subsets of each size are split over threads. Ties go
+// to the lower index. Fails when more than HELD_KARP_MAX Pokemon are
+// reachable.
+template <typename Dist>
+bool heldKarpOrder(int pokemon, Dist dist, std::vector<int> &order, std::string &error)
+{
+    const long long INF = LLONG_MAX / 4;
+    order.clear();
+    std::vector<int> stop;
+    for (int j = 0; j < pokemon; ++j)
+        if (dist(0, 2 + j) >= 0)
+            stop.push_back(j);
+    const int m = static_cast<int>(stop.size());
+    if (m == 0)
+        return true;
+    if (m > HELD_KARP_MAX)
+    {
+        error = std::to_string(m) + " reachable Pokemon, Held-Karp handles at most " + std::to_string(HELD_KARP_MAX);
+        return false;
+    }
+    std::vector<long long> step(static_cast<size_t>(m) * m), last(m);
+    const bool to_goal = dist(0, 1) >= 0;
+    for (int a = 0; a < m; ++a)
+    {
+        for (int b = 0; b < m; ++b)
+        {
+            long long d = dist(2 + stop[a], 2 + stop[b]);
+            step[a * m + b] = d < 0 ? INF : d;
+        }
+        long long d = to_goal ? dist(2 + stop[a], 1) : 0;
+        last[a] = d < 0 ? INF : d;
+    }
+
+    const uint32_t subsets = uint32_t(1) << m;
+    std::vector<long long> dp(static_cast<size_t>(subsets) * m, INF);
+    for (int a = 0; a < m; ++a)
+        dp[(size_t(1) << a) * m + a] = dist(0, 2 + stop[a]);
+    // Subsets ordered by size; layer c is masks[begin[c]] .. masks[begin[c + 1] - 1].
+    std::vector<uint32_t> begin(m + 2, 0), masks(subsets);
+    for (uint32_t mask = 0; mask < subsets; ++mask)
+        ++begin[popcount64(mask) + 1];
+    for (int c = 1; c <= m + 1; ++c)
+        begin[c] += begin[c - 1];
+    std::vector<uint32_t> fill(begin.begin(), begin.end() - 1);
+    for (uint32_t mask = 0; mask < subsets; ++mask)
+        masks[fill[popcount64(mask)]++] = mask;
+
+    auto extend = [&](uint32_t mask)
+    {
+        for (uint32_t js = mask; js != 0; js &= js - 1)
+        {
+            int j = ctz64(js);
+            uint32_t prev = mask ^ (uint32_t(1) << j);
+            const long long *from = &dp[static_cast<size_t>(prev) * m];
+            long long best = INF;
+            for (uint32_t is = prev; is != 0; is &= is - 1)
+            {
+                int i = ctz64(is);
+                if (from[i] < INF && from[i] + step[i * m + j] < best)
+                    best = from[i] + step[i * m + j];
+            }
+            dp[static_cast<size_t>(mask) * m + j] = best;
+        }
+    };
+    const size_t CHUNK = 1024;
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int c = 2; c <= m; ++c)
+    {
+        const size_t lo = begin[c], hi = begin[c + 1];
+        std::atomic<size_t> next{lo};
+        auto work = [&]()
+        {
+            for (size_t i; (i = next.fetch_add(CHUNK)) < hi;)
+                for (size_t k = i; k < std::min(hi, i + CHUNK); ++k)
+                    extend(masks[k]);
+        };
+        size_t count = std::min<size_t>(threads, (hi - lo + CHUNK - 1) / CHUNK);
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < count; ++t)
+            workers.emplace_back(work);
+        work();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    uint32_t mask = subsets - 1;
+    int j = -1;
+    long long best = INF;
+    for (int a = 0; a < m; ++a)
+        if (dp[static_cast<size_t>(mask) * m + a] < INF && dp[static_cast<size_t>(mask) * m + a] + last[a] < best)
+        {
+            best = dp[static_cast<size_t>(mask) * m + a] + last[a];
+            j = a;
+        }
+    if (j == -1)
+    {
+        error = "no tour through every reachable Pokemon";
+        return false;
+    }
+    // Walk back: the lowest i whose walk plus the step to j gives dp[mask][j].
+    while (true)
+    {
+        order.push_back(stop[j]);
+        uint32_t prev = mask ^ (uint32_t(1) << j);
+        if (prev == 0)
+            break;
+        long long want = dp[static_cast<size_t>(mask) * m + j];
+        int i = 0;
+        while (!(prev >> i & 1) || dp[static_cast<size_t>(prev) * m + i] + step[i * m + j] != want)
+            ++i;
+        mask = prev;
+        j = i;
+    }
+    std::reverse(order.begin(), order.end());
+    return true;
+}
+
+// Cost of visiting the Pokemon in order, S first and G last (G left out when
+// it cannot be reached); -1 when a leg is unreachable.
+template <typename Dist>
+long long tourCost(const std::vector<int> &order, Dist dist)
+{
+    long long total = 0;
+    int at = 0;
+    for (int j : order)
+    {
+        long long d = dist(at, 2 + j);
+        if (d < 0)
+            return -1;
+        total += d;
+        at = 2 + j;
+    }
+    if (dist(0, 1) >= 0)
+    {
+        if (dist(at, 1) < 0)
+            return -1;
+        total += dist(at, 1);
+    }
+    return total;
+}
+
+// The greedy order the programs use: always the cheapest Pokemon left, ties
+// to the lower index, until none is reachable.
+template <typename Dist>
+std::vector<int> nearestNeighborOrder(int pokemon, Dist dist)
+{
+    std::vector<int> order;
+    std::vector<char> taken(pokemon, 0);
+    for (int at = 0;;)
+    {
+        int next = -1;
+        for (int j = 0; j < pokemon; ++j)
+            if (!taken[j] && dist(at, 2 + j) >= 0 && (next == -1 || dist(at, 2 + j) < dist(at, 2 + next)))
+                next = j;
+        if (next == -1)
+            return order;
+        taken[next] = 1;
+        order.push_back(next);
+        at = 2 + next;
+    }
+}
+
+struct TourStats
+{
+    long long greedy = -1;  // tourCost() of nearestNeighborOrder()
+    long long best = -1;    // tourCost() of the order returned
+    long long restarts = 0; // perturbed local searches, over all threads
+};
+
+// Local search on an open tour t[0] = S .. t[n - 1] = G over a dense cost
+// table; the stops in between may be reordered. Costs may be asymmetric (a
+// step costs the cell it enters), so a reversed run is priced from prefix
+// sums of the costs both ways along the tour.
+class TourImprover
+{
+public:
+    TourImprover(const std::vector<long long> &cost, int n) : cost_(&cost), n_(n) {}
+
+    long long length(const std::vector<int> &t) const
+    {
+        long long total = 0;
+        for (size_t k = 0; k + 1 < t.size(); ++k)
+            total += d(t[k], t[k + 1]);
+        return total;
+    }
+
+    // 2-opt (reverse a run) and Or-opt (move a run of up to three stops)
+    // until neither finds a gain or the deadline passes.
+    template <typename Clock>
+    void improve(std::vector<int> &t, typename Clock::time_point deadline) const
+    {
+        while (Clock::now() < deadline && (twoOpt(t) || orOpt(t)))
+            ;
+    }
+
+    // Double bridge: A B C D -> A C B D on the stops, a move 2-opt and
+    // Or-opt cannot undo in one step.
+    template <typename Rng>
+    void kick(std::vector<int> &t, Rng &rng) const
+    {
+        const int m = n_ - 2;
+        if (m < 4)
+        {
+            if (m >= 2)
+                std::swap(t[1 + rng() % m], t[1 + rng() % m]);
+            return;
+        }
+        int cut[3];
+        for (int &c : cut)
+            c = 1 + static_cast<int>(rng() % (m + 1));
+        std::sort(cut, cut + 3);
+        std::rotate(t.begin() + cut[0], t.begin() + cut[1], t.begin() + cut[2]);
+    }
+
+private:
+    long long d(int a, int b) const { return (*cost_)[static_cast<size_t>(a) * n_ + b]; }
+
+    bool twoOpt(std::vector<int> &t) const
+    {
+        // fwd[k], bwd[k]: cost of t[0..k] walked forwards and backwards.
+        std::vector<long long> fwd(n_, 0), bwd(n_, 0);
+        for (int k = 1; k < n_; ++k)
+        {
+            fwd[k] = fwd[k - 1] + d(t[k - 1], t[k]);
+            bwd[k] = bwd[k - 1] + d(t[k], t[k - 1]);
+        }
+        for (int i = 1; i < n_ - 1; ++i)
+            for (int j = i + 1; j < n_ - 1; ++j)
+            {
+                long long before = d(t[i - 1], t[i]) + (fwd[j] - fwd[i]) + d(t[j], t[j + 1]);
+                long long after = d(t[i - 1], t[j]) + (bwd[j] - bwd[i]) + d(t[i], t[j + 1]);
+                if (after < before)
+                {
+                    std::reverse(t.begin() + i, t.begin() + j + 1);
+                    return true;
+                }
+            }
+        return false;
+    }
+
+    bool orOpt(std::vector<int> &t) const
+    {
+        for (int len = 1; len <= 3; ++len)
+            for (int s = 1; s + len < n_; ++s)
+            {
+                const int e = s + len - 1;
+                long long removed = d(t[s - 1], t[s]) + d(t[e], t[e + 1]) - d(t[s - 1], t[e + 1]);
+                for (int p = 0; p < n_ - 1; ++p)
+                {
+                    if (p >= s - 1 && p <= e)
+                        continue;
+                    long long added = d(t[p], t[s]) + d(t[e], t[p + 1]) - d(t[p], t[p + 1]);
+                    if (added < removed)
+                    {
+                        if (p < s)
+                            std::rotate(t.begin() + p + 1, t.begin() + s, t.begin() + e + 1);
+                        else
+                            std::rotate(t.begin() + s, t.begin() + e + 1, t.begin() + p + 1);
+                        return true;
+                    }
+                }
+            }
+        return false;
+    }
+
+    const std::vector<long long> *cost_;
+    int n_;
+};
+
+// Good order for any number of Pokemon. Starts from nearestNeighborOrder(),
+// improves it with TourImprover, then every thread kicks and re-improves its
+// best tour until seconds have passed (iterated local search, one seed per
+// thread) and the best tour found wins.
+template <typename Dist>
+std::vector<int> optimizeTour(int pokemon, Dist dist, double seconds, TourStats &stats)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    std::vector<int> greedy = nearestNeighborOrder(pokemon, dist);
+    stats.greedy = tourCost(greedy, dist);
+    stats.best = stats.greedy;
+    stats.restarts = 0;
+    const int m = static_cast<int>(greedy.size());
+    if (m < 2)
+        return greedy;
+
+    // Dense table over S, the reachable Pokemon and G: 0 is S, 1 + a is
+    // greedy[a], m + 1 is G (free to reach when the map's G is unreachable).
+    const int n = m + 2;
+    const bool to_goal = dist(0, 1) >= 0;
+    std::vector<int> point(n);
+    point[0] = 0;
+    for (int a = 0; a < m; ++a)
+        point[1 + a] = 2 + greedy[a];
+    point[n - 1] = 1;
+    const long long FAR = LLONG_MAX / 4 / n;
+    std::vector<long long> cost(static_cast<size_t>(n) * n, 0);
+    for (int a = 0; a < n; ++a)
+        for (int b = 0; b < n; ++b)
+            if (a != b && (b != n - 1 || to_goal))
+            {
+                long long d = dist(point[a], point[b]);
+                cost[static_cast<size_t>(a) * n + b] = d < 0 ? FAR : d;
+            }
+    TourImprover improver(cost, n);
+
+    std::vector<int> start(n);
+    for (int a = 0; a < n; ++a)
+        start[a] = a;
+    improver.improve<Clock>(start, deadline);
+
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<int>> best(threads, start);
+    std::vector<long long> restarts(threads, 0);
+    auto work = [&](unsigned id)
+    {
+        std::mt19937_64 rng(id + 1);
+        long long best_length = improver.length(best[id]);
+        std::vector<int> t;
+        while (Clock::now() < deadline)
+        {
+            t = best[id];
+            improver.kick(t, rng);
+            improver.improve<Clock>(t, deadline);
+            ++restarts[id];
+            long long length = improver.length(t);
+            if (length < best_length)
+            {
+                best_length = length;
+                best[id] = t;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned id = 1; id < threads; ++id)
+        workers.emplace_back(work, id);
+    work(0);
+    for (auto &w : workers)
+        w.join();
+
+    unsigned winner = 0;
+    for (unsigned id = 1; id < threads; ++id)
+        if (improver.length(best[id]) < improver.length(best[winner]))
+            winner = id;
+    std::vector<int> order;
+    for (int a = 1; a <= m; ++a)
+        order.push_back(greedy[best[winner][a] - 1]);
+    for (long long r : restarts)
+        stats.restarts += r;
+    stats.best = tourCost(order, dist);
+    return order;
+}
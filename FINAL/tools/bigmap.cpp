@@ -0,0 +1,97 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <climits>
+#include "../common/tiled_search.h"
+
+using namespace std;
+
+// Runs BFS, UCS or A* on a binary map through the tiled backend. The memory
+// limit covers the terrain cache and the per-cell search workspace; the open
+// list and the printed path come on top of it.
+// Each algorithm weighs terrain like the in-memory program it stands in for:
+// ucs with getWeight() of the ucs programs (terrain 0 and 6..9 impassable),
+// bfs and astar with cellCost() of the astar programs (only terrain 5
+// impassable, 0 and 6..9 cost 1).
+
+int getWeight(int t)
+{
+    if (t == 1) return 2;
+    if (t == 2) return 1;
+    if (t == 3) return 3;
+    if (t == 4) return 5;
+    return INT_MAX;
+}
+
+long long cellCost(int cellVal)
+{
+    static const long long cost[] = {1, 2, 1, 3, 5};
+    return cellVal == 5 ? LLONG_MAX / 4 : (cellVal >= 0 && cellVal <= 4 ? cost[cellVal] : 1);
+}
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: " << argv[0] << " <bfs|ucs|astar> <map.bin> [memory_mb]\n";
+        return 2;
+    }
+    string algo = argv[1];
+    if (algo != "bfs" && algo != "ucs" && algo != "astar")
+    {
+        cerr << "Unknown algorithm " << algo << "\n";
+        return 2;
+    }
+    double memory_mb = argc > 3 ? atof(argv[3]) : 256.0;
+    if (!(memory_mb > 0))
+    {
+        cerr << "Memory limit must be a positive number of MB\n";
+        return 2;
+    }
+    size_t memory = static_cast<size_t>(memory_mb * 1024 * 1024);
+    auto start = chrono::high_resolution_clock::now();
+
+    TiledMap map;
+    string error;
+    if (!map.open(argv[2], memory / 4, error))
+    {
+        cerr << error << "\n";
+        return 1;
+    }
+    int64_t start_id = map.start_id == -1 ? 0 : map.start_id;
+    int64_t goal_id = map.goal_id == -1 ? map.X * map.Y - 1 : map.goal_id;
+    TiledSearchResult r;
+    try
+    {
+        size_t workspace = memory - memory / 4;
+        if (algo == "bfs")
+            r = tiledBfs(map, start_id, goal_id, workspace, cellCost);
+        else if (algo == "ucs")
+            r = tiledUcs(map, start_id, goal_id, workspace, getWeight);
+        else
+            r = tiledAstar(map, start_id, goal_id, workspace, cellCost);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+
+    if (r.path.empty())
+    {
+        cout << "No path found.\n";
+        return 0;
+    }
+    cout << "Shortest path (" << algo << ", tiled):\n";
+    for (auto &c : r.path)
+        cout << c.x << "," << c.y << ":";
+    cout << "\nTotal steps: " << r.path.size() - 1;
+    cout << "\nTotal nodes opened: " << r.nodes_opened;
+    cout << "\nTotal weight: " << r.weight;
+    cout << "\nTile loads: " << r.tile_loads << ", spills: " << r.tile_spills << "\n";
+
+    auto end = chrono::high_resolution_clock::now();
+    chrono::duration<double> duration = end - start;
+    cout << "Execution time: " << duration.count() << " seconds\n";
+    return 0;
+}
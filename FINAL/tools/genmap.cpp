@@ -0,0 +1,60 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include "../common/grid_bin.h"
+
+using namespace std;
+
+// Writes a random binary map row by row, so maps far larger than RAM can be
+// generated. S is the top-left cell and G the bottom-right one.
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        cerr << "Usage: " << argv[0] << " <out.bin> <width> <height> [obstacle_percent] [seed]\n";
+        return 2;
+    }
+    int32_t X = atoi(argv[2]), Y = atoi(argv[3]);
+    int obstacle = argc > 4 ? atoi(argv[4]) : 20;
+    mt19937_64 rng(argc > 5 ? strtoull(argv[5], nullptr, 10) : 1);
+    if (X <= 0 || Y <= 0 || obstacle < 0 || obstacle > 100)
+    {
+        cerr << "Invalid size or obstacle percentage\n";
+        return 2;
+    }
+    GridBinHeader h = makeGridBinHeader(X, Y, {0, 0}, {X - 1, Y - 1}, 0, 0);
+    FILE *f = fopen(argv[1], "wb");
+    if (f == nullptr)
+    {
+        cerr << argv[1] << ": cannot create file\n";
+        return 1;
+    }
+    vector<char> pad(h.terrain_offset - sizeof(h), 0);
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(pad.data(), 1, pad.size(), f) == pad.size();
+    // Rows carry the one-cell obstacle border of the terrain layout.
+    vector<uint8_t> row(X + 2, 5);
+    ok = ok && fwrite(row.data(), 1, row.size(), f) == row.size();
+    uniform_int_distribution<int> pct(0, 99), terrain(1, 4);
+    for (int32_t y = 0; y < Y && ok; ++y)
+    {
+        for (int32_t x = 1; x <= X; ++x)
+            row[x] = pct(rng) < obstacle ? 5 : static_cast<uint8_t>(terrain(rng));
+        if (y == 0)
+            row[1] = 1;
+        if (y == Y - 1)
+            row[X] = 1;
+        ok = fwrite(row.data(), 1, row.size(), f) == row.size();
+    }
+    fill(row.begin(), row.end(), uint8_t(5));
+    ok = ok && fwrite(row.data(), 1, row.size(), f) == row.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok)
+    {
+        cerr << argv[1] << ": write failed\n";
+        return 1;
+    }
+    cout << argv[1] << ": " << X << "x" << Y << "\n";
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include "../common/grid_io.h"
+
+using namespace std;
+
+// Converts a grid.txt (optionally with "T ax ay bx by" tunnel lines) into the
+// binary map format that every search program can load directly.
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        cerr << "Usage: " << argv[0] << " <grid.txt> <grid.bin>\n";
+        return 2;
+    }
+    Grid grid;
+    int start_id, goal_id;
+    vector<Coordinate> pokemons;
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(argv[1], grid, start_id, goal_id, pokemons, tunnels, error) ||
+        !writeGridBinary(argv[2], grid, start_id, goal_id, pokemons, tunnels, error))
+    {
+        cerr << error << "\n";
+        return 1;
+    }
+    cout << argv[2] << ": " << grid.X << "x" << grid.Y << ", " << pokemons.size() << " Pokemon, "
+         << tunnels.size() << " tunnels\n";
+    return 0;
+}
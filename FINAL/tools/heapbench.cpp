@@ -0,0 +1,155 @@
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <climits>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "../common/grid_io.h"
+#include "../common/portals.h"
+#include "../common/indexed_heap.h"
+
+using namespace std;
+
+// Full-grid Dijkstra from the goal as in computeHeuristicDijkstra(): the lazy
+// version that pushes a new entry on every improvement against the indexed
+// 4-ary heap with decrease-key. Reports wall time, the largest heap size and
+// the memory the queue needs at that point.
+
+const long long INF = LLONG_MAX / 4;
+
+long long cellCost(int cellVal)
+{
+    static const long long cost[] = {1, 2, 1, 3, 5};
+    return cellVal == 5 ? INF : (cellVal >= 0 && cellVal <= 4 ? cost[cellVal] : 1);
+}
+
+struct Run
+{
+    vector<long long> dist;
+    size_t peak = 0;
+    size_t bytes = 0;
+};
+
+Run lazyDijkstra(const Grid &grid, const PortalIndex &portals, int goal_id)
+{
+    using PLL = pair<long long, int>;
+    Run r;
+    r.dist.assign(grid.size(), INF);
+    priority_queue<PLL, vector<PLL>, greater<PLL>> pq;
+    r.dist[goal_id] = 0;
+    pq.push({0, goal_id});
+    while (!pq.empty())
+    {
+        r.peak = max(r.peak, pq.size());
+        auto cur = pq.top();
+        pq.pop();
+        int u = cur.second;
+        if (cur.first != r.dist[u])
+            continue;
+        forEachNeighbor(grid, portals, u, [&](int v)
+        {
+            long long w = cellCost(grid[v]);
+            if (r.dist[v] > r.dist[u] + w)
+            {
+                r.dist[v] = r.dist[u] + w;
+                pq.push({r.dist[v], v});
+            }
+        });
+    }
+    r.bytes = r.peak * sizeof(PLL);
+    return r;
+}
+
+Run indexedDijkstra(const Grid &grid, const PortalIndex &portals, int goal_id)
+{
+    Run r;
+    r.dist.assign(grid.size(), INF);
+    IndexedHeap<long long> pq(grid.size());
+    r.dist[goal_id] = 0;
+    pq.push(goal_id, 0);
+    while (!pq.empty())
+    {
+        r.peak = max(r.peak, pq.size());
+        long long d;
+        int u = pq.pop(d);
+        forEachNeighbor(grid, portals, u, [&](int v)
+        {
+            long long w = cellCost(grid[v]);
+            if (r.dist[v] > d + w)
+            {
+                r.dist[v] = d + w;
+                pq.push(v, r.dist[v]);
+            }
+        });
+    }
+    // Entries are a key and an id, plus the position index over every cell.
+    r.bytes = r.peak * (sizeof(long long) + sizeof(int) + 4) + grid.size() * sizeof(int);
+    return r;
+}
+
+template <typename Search>
+double bestOf(int runs, Run &r, Search search)
+{
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto t0 = chrono::high_resolution_clock::now();
+        r = search();
+        chrono::duration<double> d = chrono::high_resolution_clock::now() - t0;
+        best = min(best, d.count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <map> [runs]\n";
+        return 2;
+    }
+    int runs = argc > 2 ? max(1, atoi(argv[2])) : 3;
+    Grid grid;
+    int start_id, goal_id;
+    vector<Coordinate> pokemons;
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(argv[1], grid, start_id, goal_id, pokemons, tunnels, error))
+    {
+        cerr << error << "\n";
+        return 1;
+    }
+    if (goal_id == -1)
+        goal_id = grid.id(grid.X - 1, grid.Y - 1);
+    if (grid[goal_id] == 5)
+    {
+        cerr << "Goal is an obstacle\n";
+        return 1;
+    }
+    PortalIndex portals;
+    portals.build(grid, tunnels);
+
+    Run lazy, indexed;
+    double tl = bestOf(runs, lazy, [&] { return lazyDijkstra(grid, portals, goal_id); });
+    double ti = bestOf(runs, indexed, [&] { return indexedDijkstra(grid, portals, goal_id); });
+    long long reached = 0;
+    for (long long d : lazy.dist)
+        reached += d < INF;
+    cout << argv[1] << ": " << grid.X << "x" << grid.Y << ", " << reached << " cells reached, best of " << runs
+         << " runs\n";
+    auto report = [](const char *name, const Run &r, double t)
+    {
+        cout << name << ": peak heap " << r.peak << " entries, " << r.bytes / (1024.0 * 1024.0) << " MB, "
+             << t * 1000 << " ms\n";
+    };
+    report("lazy deletion", lazy, tl);
+    report("indexed 4-ary", indexed, ti);
+    cout << "speedup: " << tl / ti << "x\n";
+    if (lazy.dist != indexed.dist)
+    {
+        cerr << "distance mismatch\n";
+        return 1;
+    }
+    return 0;
+}
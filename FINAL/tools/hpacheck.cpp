@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <string>
+#include <random>
+#include "../common/grid_io.h"
+#include "../common/portals.h"
+#include "../common/hpa.h"
+#include "../common/search.h"
+
+using namespace std;
+
+// Checks HPA* in exact mode against the plain search loop: both must find the
+// same cost between random pairs of cells. Without a map it uses a random one
+// over every terrain digit, 0 and 6..9 included, which the cost tables must
+// cover like 1..4. Weights are those of cellCost() in the astar programs.
+
+const long long INF = LLONG_MAX / 4;
+
+long long cellCost(int cellVal)
+{
+    static const long long cost[] = {1, 2, 1, 3, 5};
+    return cellVal == 5 ? INF : (cellVal >= 0 && cellVal <= 4 ? cost[cellVal] : 1);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && string(argv[1]) == "-h")
+    {
+        cerr << "Usage: " << argv[0] << " [map] [pairs] [cluster]\n";
+        return 2;
+    }
+    int pairs = argc > 2 ? max(1, atoi(argv[2])) : 200;
+    int cluster = argc > 3 ? max(2, atoi(argv[3])) : 10;
+    Grid grid;
+    vector<Tunnel> tunnels;
+    mt19937 rng(1);
+    if (argc > 1)
+    {
+        int start_id, goal_id;
+        vector<Coordinate> pokemons;
+        string error;
+        if (!loadGrid(argv[1], grid, start_id, goal_id, pokemons, tunnels, error))
+        {
+            cerr << error << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        uint8_t *cells = grid.assign(97, 61);
+        for (int y = 0; y < grid.Y; ++y)
+            for (int x = 0; x < grid.X; ++x)
+                cells[grid.id(x, y)] = static_cast<uint8_t>(rng() % 10);
+    }
+    PortalIndex portals;
+    portals.build(grid, tunnels);
+
+    HierarchicalMap hpa;
+    hpa.build(grid, &portals, cluster, true, cellCost);
+    vector<int> open;
+    for (int v = 0; v < grid.size(); ++v)
+        if (grid[v] != 5)
+            open.push_back(v);
+    if (open.empty())
+    {
+        cerr << "No passable cell\n";
+        return 1;
+    }
+    int checked = 0, wrong = 0;
+    for (int i = 0; i < pairs; ++i)
+    {
+        int s = open[rng() % open.size()], e = open[rng() % open.size()];
+        long long cost;
+        vector<int> ids = hpa.path(s, e, cost);
+        SearchResult plain = bestFirstSearch<FgHeapOpenList>(grid, s, e, PortalEdges{grid, portals}, cellCost);
+        long long got = ids.empty() ? -1 : cost;
+        long long walked = ids.empty() ? -1 : 0;
+        for (size_t k = 1; k < ids.size(); ++k)
+            walked += cellCost(grid[ids[k]]);
+        checked++;
+        if (got != plain.cost || walked != plain.cost)
+        {
+            wrong++;
+            Coordinate a = grid.coord(s), b = grid.coord(e);
+            cerr << "(" << a.x << "," << a.y << ") -> (" << b.x << "," << b.y << "): HPA* " << got << ", path "
+                 << walked << ", plain " << plain.cost << "\n";
+        }
+    }
+    cout << grid.X << "x" << grid.Y << ", cluster " << cluster << ", " << hpa.nodes() << " abstract nodes: " << checked
+         << " pairs, " << wrong << " wrong\n";
+    return wrong == 0 ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <vector>
+#include <climits>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "../common/grid_io.h"
+#include "../common/portals.h"
+#include "../common/search.h"
+
+using namespace std;
+
+// Times the two open lists behind the ucs programs on the same map, start and
+// goal: ucs() runs bestFirstSearch<HeapOpenList> and ucsBuckets() runs
+// bestFirstSearch<BucketOpenList>, both with the weights of getWeight() in
+// the ucs programs. Tunnels are followed as in FINAL/3/ucs.cpp.
+
+int getWeight(int t)
+{
+    if (t == 1) return 2;
+    if (t == 2) return 1;
+    if (t == 3) return 3;
+    if (t == 4) return 5;
+    return INT_MAX;
+}
+
+int maxWeight()
+{
+    int m = 1;
+    for (int t = 0; t <= 9; t++)
+        if (getWeight(t) != INT_MAX)
+            m = max(m, getWeight(t));
+    return m;
+}
+
+struct Run
+{
+    long long cost = -1;
+    long long opened = 0;
+};
+
+template <typename OpenList>
+Run ucsWith(const Grid &g, const PortalIndex &portals, int s, int e, OpenList open)
+{
+    auto weight = [](int t) { return getWeight(t); };
+    SearchResult r = bestFirstSearch(g, s, e, PortalEdges{g, portals}, weight, ZeroHeuristic(), open);
+    return {r.cost, r.closed};
+}
+
+template <typename Search>
+double bestOf(int runs, Run &r, Search search)
+{
+    double best = 1e300;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto t0 = chrono::high_resolution_clock::now();
+        r = search();
+        chrono::duration<double> d = chrono::high_resolution_clock::now() - t0;
+        best = min(best, d.count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: " << argv[0] << " <map> [runs]\n";
+        return 2;
+    }
+    int runs = argc > 2 ? max(1, atoi(argv[2])) : 5;
+    Grid g;
+    int s, e;
+    vector<Coordinate> pokemons;
+    vector<Tunnel> tunnels;
+    string error;
+    if (!loadGrid(argv[1], g, s, e, pokemons, tunnels, error))
+    {
+        cerr << error << "\n";
+        return 1;
+    }
+    if (s == -1)
+        s = g.id(0, 0);
+    if (e == -1)
+        e = g.id(g.X - 1, g.Y - 1);
+    PortalIndex portals;
+    portals.build(g, tunnels);
+
+    Run heap, bucket;
+    double th = bestOf(runs, heap, [&] { return ucsWith(g, portals, s, e, HeapOpenList()); });
+    double tb = bestOf(runs, bucket, [&] { return ucsWith(g, portals, s, e, BucketOpenList(maxWeight())); });
+    cout << argv[1] << ": " << g.X << "x" << g.Y << ", best of " << runs << " runs\n";
+    auto report = [](const char *name, const Run &r, double t)
+    {
+        cout << name << ": cost " << r.cost << ", nodes opened " << r.opened << ", "
+             << t * 1000 << " ms, " << r.opened / t / 1e6 << " M nodes/s\n";
+    };
+    report("binary heap ", heap, th);
+    report("bucket queue", bucket, tb);
+    cout << "speedup: " << th / tb << "x\n";
+    if (heap.cost != bucket.cost)
+    {
+        cerr << "cost mismatch\n";
+        return 1;
+    }
+    return 0;
+}